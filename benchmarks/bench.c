@@ -0,0 +1,382 @@
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../src/backend.h"
+#include "../src/draw.h"
+#include "../src/layout.h"
+#include "../src/parser.h"
+#include "../src/utils.h"
+#include "corpus.h"
+
+// Measures the parser, the layout and the drawing on generated documents (see corpus.h)
+// and writes the results as JSON, so they can be compared between versions. Everything
+// is drawn with the recording backend, so it doesn't need a GPU or a display.
+
+#define BENCH_VERSION 1
+#define BENCH_MAX_SIZES 32
+
+#define DEFAULT_SEED 42
+#define DEFAULT_ITERATIONS 5
+#define DEFAULT_FRAMES 120
+#define DEFAULT_WIDTH 1280
+#define DEFAULT_HEIGHT 720
+
+typedef struct {
+    bool kinds[CORPUS_KIND_COUNT];
+    size_t sizes[BENCH_MAX_SIZES];
+    size_t sizeCount;
+
+    uint64_t seed;
+    int iterations; // of the parser, the median is reported
+    int frames; // views that are laid out and drawn, one after the other
+    int width, height; // of the view
+    const char *outPath; // NULL for stdout
+} BenchOptions;
+
+typedef struct {
+    CorpusKind kind;
+    size_t size;
+
+    double parseMs;
+    size_t nodes;
+    size_t blocks;
+    ArenaStats arena;
+    size_t scratchBytes; // reserved by md4c while parsing
+
+    double estimateMs; // layout_update, every block gets an estimated height
+    double layoutMs; // layout_prepare of every frame
+    size_t laidOutBlocks;
+
+    double frameMedianMs; // layout and draw of a new view
+    double frameP95Ms;
+    double drawMedianMs; // draw of a view that is already laid out
+    double drawP95Ms;
+    size_t glyphs; // drawn by all the frames
+} BenchResult;
+
+static double now_ms() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * 1000.0 + time.tv_nsec / 1e6;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// sorts the values
+static double percentile(double *values, size_t count, double p) {
+    if(count == 0) return 0;
+
+    qsort(values, count, sizeof(double), compare_doubles);
+    size_t index = p * (count - 1) + 0.5;
+    return values[index];
+}
+
+static size_t count_nodes(MDNode *node) {
+    size_t count = 1;
+
+    for(MDNode *child = node->children.head; child != NULL; child = child->next) {
+        count += count_nodes(child);
+    }
+
+    return count;
+}
+
+// accepts suffixes like 1K, 64K, 16M or 1G
+static bool parse_size(const char *text, size_t *size) {
+    char *end;
+    double value = strtod(text, &end);
+    if(end == text || value < 0) return false;
+
+    switch(*end) {
+        case 'k': case 'K': value *= 1 << 10; end++; break;
+        case 'm': case 'M': value *= 1 << 20; end++; break;
+        case 'g': case 'G': value *= 1 << 30; end++; break;
+    }
+
+    *size = value;
+    return *end == '\0' && *size > 0;
+}
+
+static bool parse_list(char *list, BenchOptions *options, bool sizes) {
+    for(char *item = strtok(list, ","); item != NULL; item = strtok(NULL, ",")) {
+        if(sizes) {
+            if(options->sizeCount == BENCH_MAX_SIZES) return false;
+            if(!parse_size(item, &options->sizes[options->sizeCount++])) return false;
+        } else {
+            CorpusKind kind;
+            if(!corpus_kind_from_name(item, &kind)) return false;
+            options->kinds[kind] = true;
+        }
+    }
+
+    return true;
+}
+
+static bool parse_args(int argc, char **args, BenchOptions *options) {
+    bool anyKind = false;
+
+    for(int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+
+        if(strcmp(args[i], "--kinds") == 0 && hasValue) {
+            if(!parse_list(args[++i], options, false)) return false;
+            anyKind = true;
+        } else if(strcmp(args[i], "--sizes") == 0 && hasValue) {
+            options->sizeCount = 0;
+            if(!parse_list(args[++i], options, true)) return false;
+        } else if(strcmp(args[i], "--seed") == 0 && hasValue) {
+            options->seed = strtoull(args[++i], NULL, 10);
+        } else if(strcmp(args[i], "--iterations") == 0 && hasValue) {
+            options->iterations = atoi(args[++i]);
+        } else if(strcmp(args[i], "--frames") == 0 && hasValue) {
+            options->frames = atoi(args[++i]);
+        } else if(strcmp(args[i], "--width") == 0 && hasValue) {
+            options->width = atoi(args[++i]);
+        } else if(strcmp(args[i], "--height") == 0 && hasValue) {
+            options->height = atoi(args[++i]);
+        } else if(strcmp(args[i], "--out") == 0 && hasValue) {
+            options->outPath = args[++i];
+        } else {
+            return false;
+        }
+    }
+
+    if(!anyKind) {
+        for(CorpusKind kind = 0; kind < CORPUS_KIND_COUNT; kind++) options->kinds[kind] = true;
+    }
+
+    return options->iterations > 0 && options->frames > 0 && options->width > 0 && options->height > 0;
+}
+
+static void bench_parse(BenchOptions *options, ThreadPool *pool, const char *text, size_t size, BenchResult *result, ParserData *kept) {
+    double *times = malloc(options->iterations * sizeof(double));
+
+    for(int i = 0; i < options->iterations; i++) {
+        ParserData data = {
+            .arena = arena_create(),
+            .pool = pool,
+        };
+
+        double start = now_ms();
+        parse_text_parallel(&data, text, size);
+        times[i] = now_ms() - start;
+
+        // the tree of the last parse is used by the layout
+        if(i + 1 < options->iterations) {
+            arena_free(data.arena);
+        } else {
+            *kept = data;
+        }
+    }
+
+    result->parseMs = percentile(times, options->iterations, 0.5);
+    free(times);
+
+    if(kept->docNode != NULL) {
+        result->nodes = count_nodes(kept->docNode);
+        result->blocks = kept->docNode->children.count;
+    }
+    result->arena = arena_stats(kept->arena);
+    result->scratchBytes = kept->scratchBytes;
+}
+
+// same fonts that draw_init loads, the layout gets its own so its caches start empty
+static bool load_fonts(RenderBackend *backend, LayoutFonts *fonts) {
+    memset(fonts, 0, sizeof(LayoutFonts));
+
+    if(!backend->load_font(backend->data, "./fonts/JetBrainsMono-Regular.ttf", 50, &fonts->normal)) return false;
+    if(!backend->load_font(backend->data, "./fonts/JetBrainsMono-Bold.ttf", 50, &fonts->bold)) return false;
+    return true;
+}
+
+static void bench_layout(BenchOptions *options, LayoutFonts *fonts, MDNode *docNode, BenchResult *result) {
+    measure_cache_init(&fonts->normalCache, fonts->normal);
+    measure_cache_init(&fonts->boldCache, fonts->bold);
+
+    Layout layout = {0};
+
+    double start = now_ms();
+    layout_update(&layout, docNode, fonts, options->width);
+    result->estimateMs = now_ms() - start;
+
+    // the views that a reader scrolling down would see
+    start = now_ms();
+    for(int i = 0; i < options->frames; i++) {
+        float top = (float)i * options->height;
+        layout_prepare(&layout, top, top + options->height);
+    }
+    result->layoutMs = now_ms() - start;
+
+    for(size_t i = 0; i < layout.count; i++) {
+        if(layout.blocks[i].flow != NULL) result->laidOutBlocks++;
+    }
+
+    layout_free(&layout);
+    measure_cache_free(&fonts->normalCache);
+    measure_cache_free(&fonts->boldCache);
+}
+
+static void bench_draw(BenchOptions *options, RecordingBackend *recording, MDNode *docNode, BenchResult *result) {
+    double *frames = malloc(options->frames * sizeof(double));
+    double *draws = malloc(options->frames * sizeof(double));
+
+    recording_backend_clear(recording);
+
+    for(int i = 0; i < options->frames; i++) {
+        float top = (float)i * options->height;
+
+        double start = now_ms();
+        draw_document_region(docNode, top, top + options->height);
+        frames[i] = now_ms() - start;
+
+        // the view is laid out now, so this only draws it
+        size_t glyphs = recording->glyphs;
+        start = now_ms();
+        draw_document_region(docNode, top, top + options->height);
+        draws[i] = now_ms() - start;
+        recording->glyphs = glyphs;
+    }
+
+    result->glyphs = recording->glyphs;
+    result->frameMedianMs = percentile(frames, options->frames, 0.5);
+    result->frameP95Ms = percentile(frames, options->frames, 0.95);
+    result->drawMedianMs = percentile(draws, options->frames, 0.5);
+    result->drawP95Ms = percentile(draws, options->frames, 0.95);
+
+    draw_unload_document();
+    free(frames);
+    free(draws);
+}
+
+static void write_result(FILE *out, BenchResult *result, bool last) {
+    double parseSeconds = result->parseMs / 1000.0;
+    double megabytes = result->size / (1024.0 * 1024.0);
+
+    fprintf(out, "    {\n");
+    fprintf(out, "      \"corpus\": \"%s\",\n", corpus_kind_name(result->kind));
+    fprintf(out, "      \"size_bytes\": %zu,\n", result->size);
+    fprintf(out, "      \"parse_ms\": %.3f,\n", result->parseMs);
+    fprintf(out, "      \"parse_mb_per_s\": %.3f,\n", parseSeconds > 0 ? megabytes / parseSeconds : 0);
+    fprintf(out, "      \"nodes\": %zu,\n", result->nodes);
+    fprintf(out, "      \"nodes_per_s\": %.0f,\n", parseSeconds > 0 ? result->nodes / parseSeconds : 0);
+    fprintf(out, "      \"blocks\": %zu,\n", result->blocks);
+    fprintf(out, "      \"arena_used_bytes\": %zu,\n", result->arena.used);
+    fprintf(out, "      \"arena_reserved_bytes\": %zu,\n", result->arena.reserved);
+    fprintf(out, "      \"parse_scratch_bytes\": %zu,\n", result->scratchBytes);
+    fprintf(out, "      \"estimate_ms\": %.3f,\n", result->estimateMs);
+    fprintf(out, "      \"layout_ms\": %.3f,\n", result->layoutMs);
+    fprintf(out, "      \"laid_out_blocks\": %zu,\n", result->laidOutBlocks);
+    fprintf(out, "      \"layout_us_per_block\": %.3f,\n", result->laidOutBlocks > 0 ? result->layoutMs * 1000 / result->laidOutBlocks : 0);
+    fprintf(out, "      \"frame_ms_median\": %.3f,\n", result->frameMedianMs);
+    fprintf(out, "      \"frame_ms_p95\": %.3f,\n", result->frameP95Ms);
+    fprintf(out, "      \"draw_ms_median\": %.3f,\n", result->drawMedianMs);
+    fprintf(out, "      \"draw_ms_p95\": %.3f,\n", result->drawP95Ms);
+    fprintf(out, "      \"glyphs\": %zu\n", result->glyphs);
+    fprintf(out, "    }%s\n", last ? "" : ",");
+}
+
+int main(int argc, char **args) {
+    BenchOptions options = {
+        .sizes = { 1 << 10, 64 << 10, 1 << 20, 16 << 20 },
+        .sizeCount = 4,
+        .seed = DEFAULT_SEED,
+        .iterations = DEFAULT_ITERATIONS,
+        .frames = DEFAULT_FRAMES,
+        .width = DEFAULT_WIDTH,
+        .height = DEFAULT_HEIGHT,
+    };
+
+    if(!parse_args(argc, args, &options)) {
+        printf("Usage: ./bench [--kinds prose,nested-lists,paragraph,outline] [--sizes 1K,64K,1M,500M]\n");
+        printf("               [--seed N] [--iterations N] [--frames N] [--width N] [--height N] [--out file.json]\n");
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    // opened first so a run isn't lost because the file can't be written
+    FILE *out = options.outPath == NULL ? stdout : fopen(options.outPath, "w");
+    if(out == NULL) {
+        fprintf(stderr, "Couldn't open %s\n", options.outPath);
+        return 1;
+    }
+
+    RecordingBackend recording;
+    RenderBackend backend;
+    recording_backend_init(&backend, &recording, options.width, options.height, false);
+
+    LayoutFonts fonts;
+    if(!draw_init(&backend) || !load_fonts(&backend, &fonts)) {
+        fprintf(stderr, "Couldn't load the fonts, the benchmark has to run from the root of the repository\n");
+        backend.free(backend.data);
+
+        // there are no results to write
+        if(out != stdout) {
+            fclose(out);
+            remove(options.outPath);
+        }
+        return 1;
+    }
+
+    // the threads are started once, like in the viewer
+    ThreadPool pool;
+    thread_pool_init(&pool, 0);
+
+    size_t count = 0;
+    BenchResult *results = malloc(CORPUS_KIND_COUNT * options.sizeCount * sizeof(BenchResult));
+
+    for(CorpusKind kind = 0; kind < CORPUS_KIND_COUNT; kind++) {
+        if(!options.kinds[kind]) continue;
+
+        for(size_t i = 0; i < options.sizeCount; i++) {
+            BenchResult *result = &results[count++];
+            memset(result, 0, sizeof(BenchResult));
+            result->kind = kind;
+
+            char *text = corpus_generate(kind, options.sizes[i], options.seed, &result->size);
+            fprintf(stderr, "%s %zu bytes\n", corpus_kind_name(kind), result->size);
+
+            ParserData data = {0};
+
+            bench_parse(&options, &pool, text, result->size, result, &data);
+
+            if(data.docNode != NULL) {
+                bench_layout(&options, &fonts, data.docNode, result);
+                bench_draw(&options, &recording, data.docNode, result);
+            }
+
+            arena_free(data.arena);
+            free(text);
+        }
+    }
+
+    thread_pool_free(&pool);
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"version\": %d,\n", BENCH_VERSION);
+    fprintf(out, "  \"seed\": %llu,\n", (unsigned long long)options.seed);
+    fprintf(out, "  \"iterations\": %d,\n", options.iterations);
+    fprintf(out, "  \"frames\": %d,\n", options.frames);
+    fprintf(out, "  \"width\": %d,\n", options.width);
+    fprintf(out, "  \"height\": %d,\n", options.height);
+    fprintf(out, "  \"results\": [\n");
+
+    for(size_t i = 0; i < count; i++) {
+        write_result(out, &results[i], i + 1 == count);
+    }
+
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+
+    if(out != stdout) fclose(out);
+
+    backend.free(backend.data);
+    free(results);
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "corpus.h"
+
+static const char *kindNames[CORPUS_KIND_COUNT] = {
+    [CORPUS_PROSE] = "prose",
+    [CORPUS_NESTED_LISTS] = "nested-lists",
+    [CORPUS_PARAGRAPH] = "paragraph",
+    [CORPUS_OUTLINE] = "outline",
+};
+
+static const char *words[] = {
+    "lorem", "ipsum", "dolor", "sit", "amet", "consectetur", "adipiscing", "elit",
+    "sed", "do", "eiusmod", "tempor", "incididunt", "ut", "labore", "et", "dolore",
+    "magna", "aliqua", "enim", "ad", "minim", "veniam", "quis", "nostrud",
+    "exercitation", "ullamco", "laboris", "nisi", "aliquip", "ex", "ea", "commodo",
+    "consequat", "duis", "aute", "irure", "in", "reprehenderit", "voluptate",
+    "velit", "esse", "cillum", "fugiat", "nulla", "pariatur", "excepteur", "sint",
+    "occaecat", "cupidatat", "non", "proident", "sunt", "culpa", "qui", "officia",
+    "deserunt", "mollit", "anim", "id", "est", "laborum",
+};
+
+#define WORD_COUNT (sizeof(words) / sizeof(words[0]))
+
+// the text is written into a buffer of the requested size, what doesn't fit is dropped
+typedef struct {
+    char *data;
+    size_t size, capacity;
+    bool full;
+    uint64_t state; // of the random generator
+} Writer;
+
+// splitmix64, fast and the same on every platform
+static uint64_t next_random(Writer *writer) {
+    uint64_t z = (writer->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// random number in [min, max]
+static size_t random_range(Writer *writer, size_t min, size_t max) {
+    return min + next_random(writer) % (max - min + 1);
+}
+
+static bool is_full(Writer *writer) {
+    return writer->full;
+}
+
+// the text is written whole or not at all, so a bold word can't lose its closing
+// asterisks (md4c would see an emphasis, that the parser doesn't support)
+static void write_bytes(Writer *writer, const char *text, size_t size) {
+    if(writer->full || size > writer->capacity - writer->size) {
+        writer->full = true;
+        return;
+    }
+
+    memcpy(writer->data + writer->size, text, size);
+    writer->size += size;
+}
+
+static void write_str(Writer *writer, const char *text) {
+    write_bytes(writer, text, strlen(text));
+}
+
+static void write_repeat(Writer *writer, char c, size_t count) {
+    for(size_t i = 0; i < count; i++) write_bytes(writer, &c, 1);
+}
+
+// words separated by spaces, some of them in bold
+static void write_words(Writer *writer, size_t count, bool bold) {
+    for(size_t i = 0; i < count && !is_full(writer); i++) {
+        if(i > 0) write_str(writer, " ");
+
+        bool boldRun = bold && i + 3 < count && random_range(writer, 0, 15) == 0;
+        if(boldRun) {
+            char run[64];
+            const char *first = words[random_range(writer, 0, WORD_COUNT - 1)];
+            const char *second = words[random_range(writer, 0, WORD_COUNT - 1)];
+            write_bytes(writer, run, snprintf(run, sizeof(run), "**%s %s**", first, second));
+            i++;
+        } else {
+            write_str(writer, words[random_range(writer, 0, WORD_COUNT - 1)]);
+        }
+    }
+}
+
+static void write_sentence(Writer *writer) {
+    write_words(writer, random_range(writer, 6, 16), true);
+    write_str(writer, ".");
+}
+
+static void generate_prose(Writer *writer) {
+    while(!is_full(writer)) {
+        size_t sentences = random_range(writer, 3, 8);
+
+        for(size_t i = 0; i < sentences; i++) {
+            if(i > 0) write_str(writer, " ");
+            write_sentence(writer);
+        }
+
+        write_str(writer, "\n\n");
+    }
+}
+
+static void generate_nested_lists(Writer *writer) {
+    while(!is_full(writer)) {
+        size_t items = random_range(writer, 20, 80);
+        size_t depth = 0;
+
+        for(size_t i = 0; i < items; i++) {
+            // a nested list can only start one level deeper than its parent
+            size_t next = random_range(writer, 0, 2);
+            if(next == 0 && depth > 0) {
+                depth -= random_range(writer, 1, depth);
+            } else if(next == 2 && depth + 1 < CORPUS_MAX_LIST_DEPTH) {
+                depth++;
+            }
+
+            write_repeat(writer, ' ', depth * 2);
+            write_str(writer, "- ");
+            write_words(writer, random_range(writer, 3, 12), true);
+            write_str(writer, "\n");
+        }
+
+        // a paragraph ends the list, after a blank line it would only become loose
+        write_str(writer, "\n");
+        write_sentence(writer);
+        write_str(writer, "\n\n");
+    }
+}
+
+static void generate_paragraph(Writer *writer) {
+    // a single line, the parser doesn't support soft line breaks
+    while(!is_full(writer)) {
+        write_words(writer, random_range(writer, 8, 14), true);
+        write_str(writer, " ");
+    }
+}
+
+static void generate_outline(Writer *writer) {
+    size_t level = 1;
+
+    while(!is_full(writer)) {
+        size_t next = random_range(writer, 0, 2);
+        if(next == 0 && level > 1) {
+            level -= random_range(writer, 1, level - 1);
+        } else if(next == 2 && level < 6) {
+            level++;
+        }
+
+        write_repeat(writer, '#', level);
+        write_str(writer, " ");
+        write_words(writer, random_range(writer, 2, 6), false);
+        write_str(writer, "\n\n");
+
+        if(random_range(writer, 0, 9) < 3) {
+            write_sentence(writer);
+            write_str(writer, "\n\n");
+        }
+    }
+}
+
+const char *corpus_kind_name(CorpusKind kind) {
+    return kindNames[kind];
+}
+
+bool corpus_kind_from_name(const char *name, CorpusKind *kind) {
+    for(CorpusKind i = 0; i < CORPUS_KIND_COUNT; i++) {
+        if(strcmp(kindNames[i], name) == 0) {
+            *kind = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+char *corpus_generate(CorpusKind kind, size_t size, uint64_t seed, size_t *outSize) {
+    Writer writer = {
+        .data = malloc(size == 0 ? 1 : size),
+        .capacity = size,
+        // every kind gets different text for the same seed
+        .state = seed ^ ((uint64_t)kind << 56),
+    };
+
+    switch(kind) {
+        case CORPUS_PROSE: generate_prose(&writer); break;
+        case CORPUS_NESTED_LISTS: generate_nested_lists(&writer); break;
+        case CORPUS_PARAGRAPH: generate_paragraph(&writer); break;
+        case CORPUS_OUTLINE: generate_outline(&writer); break;
+        case CORPUS_KIND_COUNT: break;
+    }
+
+    *outSize = writer.size;
+    return writer.data;
+}
@@ -0,0 +1,30 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Synthetic markdown for the benchmarks. The same kind, size and seed always give the
+// same text, so the results of two versions can be compared. Only the blocks and spans
+// that the parser supports are generated (paragraphs, headers, lists and bold text).
+
+typedef enum {
+    CORPUS_PROSE, // paragraphs of sentences with some bold words
+    CORPUS_NESTED_LISTS, // lists nested up to CORPUS_MAX_LIST_DEPTH levels
+    CORPUS_PARAGRAPH, // a single paragraph with the whole size
+    CORPUS_OUTLINE, // headers of every level with short paragraphs between some of them
+    CORPUS_KIND_COUNT,
+} CorpusKind;
+
+#define CORPUS_MAX_LIST_DEPTH 16
+
+const char *corpus_kind_name(CorpusKind kind);
+// returns false if there's no kind with that name
+bool corpus_kind_from_name(const char *name, CorpusKind *kind);
+
+// generates up to size bytes of markdown, the last block can be cut but it ends at a
+// whole word. The result is malloc'd
+char *corpus_generate(CorpusKind kind, size_t size, uint64_t seed, size_t *outSize);
+
+#endif // CORPUS_H
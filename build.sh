@@ -1,4 +1,11 @@
 #!/bin/bash
 
-FILES="src/main.c src/utils.c src/draw.c src/parser.c md4c/md4c.c"
-gcc -Wall -Werror -o main $FILES -I./raylib-5.5/include -L./raylib-5.5/lib/ -l:libraylib.a -lm -lcurl
+FILES="src/main.c src/utils.c src/flattree.c src/cache.c src/split.c src/document.c src/watch.c src/measure.c src/batch.c src/layout.c src/draw.c src/raster.c src/backend.c src/tiles.c src/scroll.c src/redraw.c src/stats.c src/trace.c src/overlay.c src/parser.c md4c/md4c.c"
+LIBS="-I./raylib-5.5/include -L./raylib-5.5/lib/ -l:libraylib.a -lm -lpthread -lcurl"
+
+if [ "$1" == "bench" ]; then
+    # ./build.sh bench builds ./bench, see benchmarks/bench.c
+    gcc -Wall -Werror -O2 -o bench benchmarks/bench.c benchmarks/corpus.c ${FILES/src\/main.c/} $LIBS
+else
+    gcc -Wall -Werror -o main $FILES $LIBS
+fi
@@ -82,6 +82,20 @@
             ctx->parser.debug_log((msg), ctx->userdata);                \
     } while(0)
 
+/* All memory goes through the allocator of the parser, if it has one. */
+#define MD_REALLOC(ptr, sz)                                             \
+    (ctx->parser.mem_realloc != NULL                                    \
+        ? ctx->parser.mem_realloc((ptr), (sz), ctx->userdata)           \
+        : realloc((ptr), (sz)))
+#define MD_MALLOC(sz)           MD_REALLOC(NULL, (sz))
+#define MD_FREE(ptr)                                                    \
+    do {                                                                \
+        if(ctx->parser.mem_free != NULL)                                \
+            ctx->parser.mem_free((ptr), ctx->userdata);                 \
+        else                                                            \
+            free(ptr);                                                  \
+    } while(0)
+
 #ifdef DEBUG
     #define MD_ASSERT(cond)                                             \
             do {                                                        \
@@ -426,7 +440,7 @@ md_text_with_null_replacement(MD_CTX* ctx, MD_TEXTTYPE type, const CHAR* str, SZ
             CHAR* new_buffer;                                               \
             SZ new_size = ((sz) + (sz) / 2 + 128) & ~127;                   \
                                                                             \
-            new_buffer = realloc(ctx->buffer, new_size);                    \
+            new_buffer = MD_REALLOC(ctx->buffer, new_size);                 \
             if(new_buffer == NULL) {                                        \
                 MD_LOG("realloc() failed.");                                \
                 ret = -1;                                                   \
@@ -1032,7 +1046,7 @@ md_merge_lines_alloc(MD_CTX* ctx, OFF beg, OFF end, const MD_LINE* lines, MD_SIZ
 {
     CHAR* buffer;
 
-    buffer = (CHAR*) malloc(sizeof(CHAR) * (end - beg));
+    buffer = (CHAR*) MD_MALLOC(sizeof(CHAR) * (end - beg));
     if(buffer == NULL) {
         MD_LOG("malloc() failed.");
         return -1;
@@ -1434,18 +1448,18 @@ md_build_attr_append_substr(MD_CTX* ctx, MD_ATTRIBUTE_BUILD* build,
         build->substr_alloc = (build->substr_alloc > 0
                 ? build->substr_alloc + build->substr_alloc / 2
                 : 8);
-        new_substr_types = (MD_TEXTTYPE*) realloc(build->substr_types,
+        new_substr_types = (MD_TEXTTYPE*) MD_REALLOC(build->substr_types,
                                     build->substr_alloc * sizeof(MD_TEXTTYPE));
         if(new_substr_types == NULL) {
             MD_LOG("realloc() failed.");
             return -1;
         }
         /* Note +1 to reserve space for final offset (== raw_size). */
-        new_substr_offsets = (OFF*) realloc(build->substr_offsets,
+        new_substr_offsets = (OFF*) MD_REALLOC(build->substr_offsets,
                                     (build->substr_alloc+1) * sizeof(OFF));
         if(new_substr_offsets == NULL) {
             MD_LOG("realloc() failed.");
-            free(new_substr_types);
+            MD_FREE(new_substr_types);
             return -1;
         }
 
@@ -1465,9 +1479,9 @@ md_free_attribute(MD_CTX* ctx, MD_ATTRIBUTE_BUILD* build)
     MD_UNUSED(ctx);
 
     if(build->substr_alloc > 0) {
-        free(build->text);
-        free(build->substr_types);
-        free(build->substr_offsets);
+        MD_FREE(build->text);
+        MD_FREE(build->substr_types);
+        MD_FREE(build->substr_offsets);
     }
 }
 
@@ -1502,7 +1516,7 @@ md_build_attribute(MD_CTX* ctx, const CHAR* raw_text, SZ raw_size,
         build->trivial_offsets[1] = raw_size;
         off = raw_size;
     } else {
-        build->text = (CHAR*) malloc(raw_size * sizeof(CHAR));
+        build->text = (CHAR*) MD_MALLOC(raw_size * sizeof(CHAR));
         if(build->text == NULL) {
             MD_LOG("malloc() failed.");
             goto abort;
@@ -1746,7 +1760,7 @@ md_build_ref_def_hashtable(MD_CTX* ctx)
         return 0;
 
     ctx->ref_def_hashtable_size = (ctx->n_ref_defs * 5) / 4;
-    ctx->ref_def_hashtable = malloc(ctx->ref_def_hashtable_size * sizeof(void*));
+    ctx->ref_def_hashtable = MD_MALLOC(ctx->ref_def_hashtable_size * sizeof(void*));
     if(ctx->ref_def_hashtable == NULL) {
         MD_LOG("malloc() failed.");
         goto abort;
@@ -1785,7 +1799,7 @@ md_build_ref_def_hashtable(MD_CTX* ctx)
             }
 
             /* Make the bucket complex, i.e. able to hold more ref. defs. */
-            list = (MD_REF_DEF_LIST*) malloc(sizeof(MD_REF_DEF_LIST) + 2 * sizeof(MD_REF_DEF*));
+            list = (MD_REF_DEF_LIST*) MD_MALLOC(sizeof(MD_REF_DEF_LIST) + 2 * sizeof(MD_REF_DEF*));
             if(list == NULL) {
                 MD_LOG("malloc() failed.");
                 goto abort;
@@ -1807,7 +1821,7 @@ md_build_ref_def_hashtable(MD_CTX* ctx)
         list = (MD_REF_DEF_LIST*) bucket;
         if(list->n_ref_defs >= list->alloc_ref_defs) {
             int alloc_ref_defs = list->alloc_ref_defs + list->alloc_ref_defs / 2;
-            MD_REF_DEF_LIST* list_tmp = (MD_REF_DEF_LIST*) realloc(list,
+            MD_REF_DEF_LIST* list_tmp = (MD_REF_DEF_LIST*) MD_REALLOC(list,
                         sizeof(MD_REF_DEF_LIST) + alloc_ref_defs * sizeof(MD_REF_DEF*));
             if(list_tmp == NULL) {
                 MD_LOG("realloc() failed.");
@@ -1863,10 +1877,10 @@ md_free_ref_def_hashtable(MD_CTX* ctx)
                 continue;
             if(ctx->ref_defs <= (MD_REF_DEF*) bucket  &&  (MD_REF_DEF*) bucket < ctx->ref_defs + ctx->n_ref_defs)
                 continue;
-            free(bucket);
+            MD_FREE(bucket);
         }
 
-        free(ctx->ref_def_hashtable);
+        MD_FREE(ctx->ref_def_hashtable);
     }
 }
 
@@ -2232,7 +2246,7 @@ md_is_link_reference_definition(MD_CTX* ctx, const MD_LINE* lines, MD_SIZE n_lin
         ctx->alloc_ref_defs = (ctx->alloc_ref_defs > 0
                 ? ctx->alloc_ref_defs + ctx->alloc_ref_defs / 2
                 : 16);
-        new_defs = (MD_REF_DEF*) realloc(ctx->ref_defs, ctx->alloc_ref_defs * sizeof(MD_REF_DEF));
+        new_defs = (MD_REF_DEF*) MD_REALLOC(ctx->ref_defs, ctx->alloc_ref_defs * sizeof(MD_REF_DEF));
         if(new_defs == NULL) {
             MD_LOG("realloc() failed.");
             goto abort;
@@ -2273,9 +2287,9 @@ md_is_link_reference_definition(MD_CTX* ctx, const MD_LINE* lines, MD_SIZE n_lin
 abort:
     /* Failure. */
     if(def != NULL  &&  def->label_needs_free)
-        free(def->label);
+        MD_FREE(def->label);
     if(def != NULL  &&  def->title_needs_free)
-        free(def->title);
+        MD_FREE(def->title);
     return ret;
 }
 
@@ -2321,7 +2335,7 @@ md_is_link_reference(MD_CTX* ctx, const MD_LINE* lines, MD_SIZE n_lines,
     }
 
     if(is_multiline)
-        free(label);
+        MD_FREE(label);
 
     if(def != NULL) {
         /* See https://github.com/mity/md4c/issues/238 */
@@ -2444,12 +2458,12 @@ md_free_ref_defs(MD_CTX* ctx)
         MD_REF_DEF* def = &ctx->ref_defs[i];
 
         if(def->label_needs_free)
-            free(def->label);
+            MD_FREE(def->label);
         if(def->title_needs_free)
-            free(def->title);
+            MD_FREE(def->title);
     }
 
-    free(ctx->ref_defs);
+    MD_FREE(ctx->ref_defs);
 }
 
 
@@ -2604,7 +2618,7 @@ md_add_mark(MD_CTX* ctx)
         ctx->alloc_marks = (ctx->alloc_marks > 0
                 ? ctx->alloc_marks + ctx->alloc_marks / 2
                 : 64);
-        new_marks = realloc(ctx->marks, ctx->alloc_marks * sizeof(MD_MARK));
+        new_marks = MD_REALLOC(ctx->marks, ctx->alloc_marks * sizeof(MD_MARK));
         if(new_marks == NULL) {
             MD_LOG("realloc() failed.");
             return NULL;
@@ -3576,7 +3590,7 @@ md_resolve_links(MD_CTX* ctx, const MD_LINE* lines, MD_SIZE n_lines)
                             if(ctx->marks[mark->next].beg >= inline_link_end) {
                                 /* Cancel the link status. */
                                 if(attr.title_needs_free)
-                                    free(attr.title);
+                                    MD_FREE(attr.title);
                                 is_link = FALSE;
                                 break;
                             }
@@ -4571,7 +4585,7 @@ md_process_table_row(MD_CTX* ctx, MD_BLOCKTYPE cell_type, OFF beg, OFF end,
     /* We have to remember the cell boundaries in local buffer because
      * ctx->marks[] shall be reused during cell contents processing. */
     n = ctx->n_table_cell_boundaries + 2;
-    pipe_offs = (OFF*) malloc(n * sizeof(OFF));
+    pipe_offs = (OFF*) MD_MALLOC(n * sizeof(OFF));
     if(pipe_offs == NULL) {
         MD_LOG("malloc() failed.");
         ret = -1;
@@ -4599,7 +4613,7 @@ md_process_table_row(MD_CTX* ctx, MD_BLOCKTYPE cell_type, OFF beg, OFF end,
     MD_LEAVE_BLOCK(MD_BLOCK_TR, NULL);
 
 abort:
-    free(pipe_offs);
+    MD_FREE(pipe_offs);
 
     ctx->table_cell_boundaries_head = -1;
     ctx->table_cell_boundaries_tail = -1;
@@ -4618,7 +4632,7 @@ md_process_table_block_contents(MD_CTX* ctx, int col_count, const MD_LINE* lines
      * with the underlines. */
     MD_ASSERT(n_lines >= 2);
 
-    align = malloc(col_count * sizeof(MD_ALIGN));
+    align = MD_MALLOC(col_count * sizeof(MD_ALIGN));
     if(align == NULL) {
         MD_LOG("malloc() failed.");
         ret = -1;
@@ -4642,7 +4656,7 @@ md_process_table_block_contents(MD_CTX* ctx, int col_count, const MD_LINE* lines
     }
 
 abort:
-    free(align);
+    MD_FREE(align);
     return ret;
 }
 
@@ -4699,7 +4713,7 @@ md_process_normal_block_contents(MD_CTX* ctx, const MD_LINE* lines, MD_SIZE n_li
 abort:
     /* Free any temporary memory blocks stored within some dummy marks. */
     for(i = ctx->ptr_stack.top; i >= 0; i = ctx->marks[i].next)
-        free(md_mark_get_ptr(ctx, i));
+        MD_FREE(md_mark_get_ptr(ctx, i));
     ctx->ptr_stack.top = -1;
 
     return ret;
@@ -4987,7 +5001,7 @@ md_push_block_bytes(MD_CTX* ctx, int n_bytes)
         ctx->alloc_block_bytes = (ctx->alloc_block_bytes > 0
                 ? ctx->alloc_block_bytes + ctx->alloc_block_bytes / 2
                 : 512);
-        new_block_bytes = realloc(ctx->block_bytes, ctx->alloc_block_bytes);
+        new_block_bytes = MD_REALLOC(ctx->block_bytes, ctx->alloc_block_bytes);
         if(new_block_bytes == NULL) {
             MD_LOG("realloc() failed.");
             return NULL;
@@ -5635,7 +5649,7 @@ md_push_container(MD_CTX* ctx, const MD_CONTAINER* container)
         ctx->alloc_containers = (ctx->alloc_containers > 0
                 ? ctx->alloc_containers + ctx->alloc_containers / 2
                 : 16);
-        new_containers = realloc(ctx->containers, ctx->alloc_containers * sizeof(MD_CONTAINER));
+        new_containers = MD_REALLOC(ctx->containers, ctx->alloc_containers * sizeof(MD_CONTAINER));
         if(new_containers == NULL) {
             MD_LOG("realloc() failed.");
             return -1;
@@ -6440,6 +6454,89 @@ abort:
 }
 
 
+/* Releases what only lives during the parsing of a single document. */
+static void
+md_free_doc_data(MD_CTX* ctx)
+{
+    md_free_ref_defs(ctx);
+    md_free_ref_def_hashtable(ctx);
+}
+
+/* Releases the growable buffers, they can be kept for the next document. */
+static void
+md_free_buffers(MD_CTX* ctx)
+{
+    MD_FREE(ctx->buffer);
+    MD_FREE(ctx->marks);
+    MD_FREE(ctx->block_bytes);
+    MD_FREE(ctx->containers);
+}
+
+static void
+md_move_buffers(MD_CTX* dst, MD_CTX* src)
+{
+    dst->buffer = src->buffer;
+    dst->alloc_buffer = src->alloc_buffer;
+    dst->marks = src->marks;
+    dst->alloc_marks = src->alloc_marks;
+    dst->block_bytes = src->block_bytes;
+    dst->alloc_block_bytes = src->alloc_block_bytes;
+    dst->containers = src->containers;
+    dst->alloc_containers = src->alloc_containers;
+}
+
+static int
+md_check_parser(const MD_PARSER* parser, void* userdata)
+{
+    if(parser->abi_version != 0) {
+        if(parser->debug_log != NULL)
+            parser->debug_log("Unsupported abi_version.", userdata);
+        return -1;
+    }
+
+    if((parser->mem_realloc == NULL) != (parser->mem_free == NULL)) {
+        if(parser->debug_log != NULL)
+            parser->debug_log("Only one of mem_realloc and mem_free is set.", userdata);
+        return -1;
+    }
+
+    return 0;
+}
+
+/* Sets up the parts of the context which only depend on the parser. */
+static void
+md_init_ctx(MD_CTX* ctx, const MD_PARSER* parser)
+{
+    memset(ctx, 0, sizeof(MD_CTX));
+    memcpy(&ctx->parser, parser, sizeof(MD_PARSER));
+    ctx->code_indent_offset = (ctx->parser.flags & MD_FLAG_NOINDENTEDCODEBLOCKS) ? (OFF)(-1) : 4;
+    md_build_mark_char_map(ctx);
+}
+
+/* Sets up the context for a document. The rest of the per-document state has
+ * to be zero, as left by md_init_ctx(). */
+static void
+md_start_doc(MD_CTX* ctx, const MD_CHAR* text, MD_SIZE size, void* userdata)
+{
+    int i;
+
+    ctx->text = text;
+    ctx->size = size;
+    ctx->userdata = userdata;
+    ctx->doc_ends_with_newline = (size > 0  &&  ISNEWLINE_(text[size-1]));
+    ctx->max_ref_def_output = MIN(MIN(16 * (uint64_t)size, (uint64_t)(1024 * 1024)), (uint64_t)SZ_MAX);
+
+    /* Reset all mark stacks and lists. */
+    for(i = 0; i < (int) SIZEOF_ARRAY(ctx->opener_stacks); i++)
+        ctx->opener_stacks[i].top = -1;
+    ctx->ptr_stack.top = -1;
+    ctx->unresolved_link_head = -1;
+    ctx->unresolved_link_tail = -1;
+    ctx->table_cell_boundaries_head = -1;
+    ctx->table_cell_boundaries_tail = -1;
+}
+
+
 /********************
  ***  Public API  ***
  ********************/
@@ -6448,45 +6545,87 @@ int
 md_parse(const MD_CHAR* text, MD_SIZE size, const MD_PARSER* parser, void* userdata)
 {
     MD_CTX ctx;
-    int i;
     int ret;
 
-    if(parser->abi_version != 0) {
-        if(parser->debug_log != NULL)
-            parser->debug_log("Unsupported abi_version.", userdata);
+    if(md_check_parser(parser, userdata) != 0)
         return -1;
-    }
 
     /* Setup context structure. */
-    memset(&ctx, 0, sizeof(MD_CTX));
-    ctx.text = text;
-    ctx.size = size;
-    memcpy(&ctx.parser, parser, sizeof(MD_PARSER));
-    ctx.userdata = userdata;
-    ctx.code_indent_offset = (ctx.parser.flags & MD_FLAG_NOINDENTEDCODEBLOCKS) ? (OFF)(-1) : 4;
-    md_build_mark_char_map(&ctx);
-    ctx.doc_ends_with_newline = (size > 0  &&  ISNEWLINE_(text[size-1]));
-    ctx.max_ref_def_output = MIN(MIN(16 * (uint64_t)size, (uint64_t)(1024 * 1024)), (uint64_t)SZ_MAX);
-
-    /* Reset all mark stacks and lists. */
-    for(i = 0; i < (int) SIZEOF_ARRAY(ctx.opener_stacks); i++)
-        ctx.opener_stacks[i].top = -1;
-    ctx.ptr_stack.top = -1;
-    ctx.unresolved_link_head = -1;
-    ctx.unresolved_link_tail = -1;
-    ctx.table_cell_boundaries_head = -1;
-    ctx.table_cell_boundaries_tail = -1;
+    md_init_ctx(&ctx, parser);
+    md_start_doc(&ctx, text, size, userdata);
 
     /* All the work. */
     ret = md_process_doc(&ctx);
 
     /* Clean-up. */
-    md_free_ref_defs(&ctx);
-    md_free_ref_def_hashtable(&ctx);
-    free(ctx.buffer);
-    free(ctx.marks);
-    free(ctx.block_bytes);
-    free(ctx.containers);
+    md_free_doc_data(&ctx);
+    md_free_buffers(&ctx);
 
     return ret;
 }
+
+struct MD_PARSER_CTX_tag {
+    /* Context before any document, copied for every document. */
+    MD_CTX init;
+
+    /* Only the growable buffers are used, they are kept between the documents. */
+    MD_CTX kept;
+};
+
+MD_PARSER_CTX*
+md_parser_create(const MD_PARSER* parser)
+{
+    MD_PARSER_CTX* pctx;
+
+    if(md_check_parser(parser, NULL) != 0)
+        return NULL;
+
+    if(parser->mem_realloc != NULL)
+        pctx = (MD_PARSER_CTX*) parser->mem_realloc(NULL, sizeof(MD_PARSER_CTX), NULL);
+    else
+        pctx = (MD_PARSER_CTX*) malloc(sizeof(MD_PARSER_CTX));
+    if(pctx == NULL) {
+        if(parser->debug_log != NULL)
+            parser->debug_log("malloc() failed.", NULL);
+        return NULL;
+    }
+
+    md_init_ctx(&pctx->init, parser);
+    memcpy(&pctx->kept, &pctx->init, sizeof(MD_CTX));
+    return pctx;
+}
+
+int
+md_parser_parse(MD_PARSER_CTX* pctx, const MD_CHAR* text, MD_SIZE size, void* userdata)
+{
+    MD_CTX ctx;
+    int ret;
+
+    memcpy(&ctx, &pctx->init, sizeof(MD_CTX));
+    md_move_buffers(&ctx, &pctx->kept);
+    md_start_doc(&ctx, text, size, userdata);
+
+    ret = md_process_doc(&ctx);
+
+    /* The buffers may have been moved by growing them. */
+    md_free_doc_data(&ctx);
+    md_move_buffers(&pctx->kept, &ctx);
+
+    return ret;
+}
+
+void
+md_parser_reset(MD_PARSER_CTX* pctx)
+{
+    md_free_buffers(&pctx->kept);
+    memcpy(&pctx->kept, &pctx->init, sizeof(MD_CTX));
+}
+
+void
+md_parser_destroy(MD_PARSER_CTX* pctx)
+{
+    MD_CTX* ctx = &pctx->init;
+
+    md_free_buffers(&pctx->kept);
+    MD_FREE(pctx);
+}
@@ -26,6 +26,8 @@
 #ifndef MD4C_H
 #define MD4C_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
     extern "C" {
 #endif
@@ -380,6 +382,20 @@ typedef struct MD_PARSER {
     /* Reserved. Set to NULL.
      */
     void (*syntax)(void);
+
+    /* Memory allocation callbacks. Optional (both may be NULL).
+     *
+     * If provided, all the memory used by the parser is allocated and released
+     * through them instead of realloc() and free(). 'mem_realloc' behaves like
+     * realloc(): 'ptr' is NULL for a new allocation, and NULL is returned on
+     * failure. The memory is always released with 'mem_free' before md_parse()
+     * returns, so an allocator may also ignore 'mem_free' and release all the
+     * memory at once afterwards.
+     *
+     * Either both or none of them have to be set.
+     */
+    void* (*mem_realloc)(void* /*ptr*/, size_t /*size*/, void* /*userdata*/);
+    void (*mem_free)(void* /*ptr*/, void* /*userdata*/);
 } MD_PARSER;
 
 
@@ -400,6 +416,37 @@ typedef MD_PARSER MD_RENDERER;
 int md_parse(const MD_CHAR* text, MD_SIZE size, const MD_PARSER* parser, void* userdata);
 
 
+/* Reusable parser.
+ *
+ * md_parse() allocates its internal buffers (block buffer, marks, containers,
+ * auxiliary buffer) for every document and releases them at the end. When many
+ * small documents are parsed, a parser object created with md_parser_create()
+ * keeps those buffers between the documents, so they only grow until they fit
+ * the biggest document. Everything else is still released after every document.
+ *
+ * md_parser_parse() behaves like md_parse() with the MD_PARSER given to
+ * md_parser_create(). A parser object can only be used by a single thread at a
+ * time.
+ *
+ * md_parser_reset() releases the kept buffers, e.g. after a huge document, and
+ * the object can still be used. md_parser_destroy() releases everything.
+ *
+ * If MD_PARSER provides the memory callbacks, the kept buffers are grown with
+ * the userdata of the md_parser_parse() call, so the allocator has to outlive
+ * the parses. They are called with NULL userdata by md_parser_create(),
+ * md_parser_reset() and md_parser_destroy().
+ *
+ * md_parser_create() returns NULL if the MD_PARSER is not valid or the memory
+ * can't be allocated.
+ */
+typedef struct MD_PARSER_CTX_tag MD_PARSER_CTX;
+
+MD_PARSER_CTX* md_parser_create(const MD_PARSER* parser);
+int md_parser_parse(MD_PARSER_CTX* pctx, const MD_CHAR* text, MD_SIZE size, void* userdata);
+void md_parser_reset(MD_PARSER_CTX* pctx);
+void md_parser_destroy(MD_PARSER_CTX* pctx);
+
+
 #ifdef __cplusplus
     }  /* extern "C" { */
 #endif
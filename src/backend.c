@@ -0,0 +1,339 @@
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend.h"
+
+// same values that LoadFontEx uses
+#define FONT_GLYPH_COUNT 95
+#define FONT_GLYPH_PADDING 4
+
+// the same glyphs and atlas as LoadFontEx without uploading the atlas to a texture
+// the font only gets a fake texture with the id and the size of the atlas
+static bool load_font_cpu(const char *fileName, int fontSize, unsigned int id, Font *font, Image *atlas) {
+    int size;
+    unsigned char *data = LoadFileData(fileName, &size);
+    if(data == NULL) return false;
+
+    memset(font, 0, sizeof(Font));
+    font->baseSize = fontSize;
+    font->glyphCount = FONT_GLYPH_COUNT;
+    font->glyphPadding = FONT_GLYPH_PADDING;
+    font->glyphs = LoadFontData(data, size, fontSize, NULL, FONT_GLYPH_COUNT, FONT_DEFAULT);
+    UnloadFileData(data);
+
+    if(font->glyphs == NULL) return false;
+
+    *atlas = GenImageFontAtlas(font->glyphs, &font->recs, FONT_GLYPH_COUNT, fontSize, FONT_GLYPH_PADDING, 0);
+
+    font->texture = (Texture2D){
+        .id = id,
+        .width = atlas->width,
+        .height = atlas->height,
+        .mipmaps = 1,
+        .format = atlas->format,
+    };
+
+    return true;
+}
+
+// the fonts of load_font_cpu don't have a real texture to unload
+static void unload_font_cpu(Font *font) {
+    UnloadFontData(font->glyphs, font->glyphCount);
+    MemFree(font->recs);
+}
+
+static bool raylib_load_font(void *data, const char *fileName, int size, Font *font) {
+    (void)data;
+
+    *font = LoadFontEx(fileName, size, NULL, 0);
+    SetTextureFilter(font->texture, TEXTURE_FILTER_BILINEAR);
+    return font->glyphs != NULL;
+}
+
+static void raylib_viewport_size(void *data, int *width, int *height) {
+    (void)data;
+
+    *width = GetScreenWidth();
+    *height = GetScreenHeight();
+}
+
+static void raylib_draw_text(
+    void *data, MeasureCache *cache,
+    const char *text, size_t size,
+    Vector2 pos, float fontSize, float spacing, Color color
+) {
+    RaylibBackend *raylib = data;
+    batch_text(&raylib->batch, cache, text, size, pos, fontSize, spacing, color);
+}
+
+static void raylib_draw_circle(void *data, Vector2 center, float radius, Color color) {
+    RaylibBackend *raylib = data;
+    batch_circle(&raylib->batch, center, radius, color);
+}
+
+static void raylib_begin(void *data, float top, float bottom) {
+    (void)data;
+    (void)top;
+    (void)bottom;
+}
+
+static void raylib_flush(void *data, float top, float bottom) {
+    (void)top;
+    (void)bottom;
+
+    RaylibBackend *raylib = data;
+    // everything is drawn with one draw call per texture
+    batch_flush(&raylib->batch);
+}
+
+static void raylib_free(void *data) {
+    RaylibBackend *raylib = data;
+    batch_free(&raylib->batch);
+}
+
+void raylib_backend_init(RenderBackend *backend, RaylibBackend *raylib) {
+    memset(raylib, 0, sizeof(RaylibBackend));
+
+    *backend = (RenderBackend){
+        .name = "raylib",
+        .data = raylib,
+        .load_font = raylib_load_font,
+        .viewport_size = raylib_viewport_size,
+        .draw_text = raylib_draw_text,
+        .draw_circle = raylib_draw_circle,
+        .begin = raylib_begin,
+        .flush = raylib_flush,
+        .free = raylib_free,
+    };
+}
+
+static bool software_load_font(void *data, const char *fileName, int size, Font *font) {
+    SoftwareBackend *software = data;
+    if(software->atlasCount == SOFTWARE_BACKEND_MAX_FONTS) return false;
+
+    // the ids can't be the ones of real textures (like the one of the shapes)
+    unsigned int id = UINT_MAX - software->atlasCount;
+
+    Image atlas;
+    if(!load_font_cpu(fileName, size, id, font, &atlas)) return false;
+
+    software->fonts[software->atlasCount] = *font;
+    software->atlases[software->atlasCount++] = (RasterTexture){
+        .id = id,
+        .pixels = LoadImageColors(atlas),
+        .width = atlas.width,
+        .height = atlas.height,
+    };
+    UnloadImage(atlas);
+
+    return true;
+}
+
+static void software_viewport_size(void *data, int *width, int *height) {
+    SoftwareBackend *software = data;
+
+    *width = software->width;
+    *height = software->image.height;
+}
+
+static void software_draw_text(
+    void *data, MeasureCache *cache,
+    const char *text, size_t size,
+    Vector2 pos, float fontSize, float spacing, Color color
+) {
+    SoftwareBackend *software = data;
+    batch_text(&software->batch, cache, text, size, pos, fontSize, spacing, color);
+}
+
+static void software_draw_circle(void *data, Vector2 center, float radius, Color color) {
+    SoftwareBackend *software = data;
+    batch_circle(&software->batch, center, radius, color);
+}
+
+static void software_begin(void *data, float top, float bottom) {
+    SoftwareBackend *software = data;
+
+    software->top = top;
+    software->bottom = bottom;
+}
+
+static void software_flush(void *data, float top, float bottom) {
+    SoftwareBackend *software = data;
+
+    // the rows outside of [top, bottom) belong to other flushes, so the quads that are
+    // in two of them aren't blended twice
+    raster_flush(
+        &software->batch, &software->image, floorf(top), floorf(bottom),
+        software->atlases, software->atlasCount
+    );
+}
+
+// the batch is full in the middle of a range, so what's queued is drawn for that range
+static void software_overflow(void *data) {
+    SoftwareBackend *software = data;
+    software_flush(data, software->top, software->bottom);
+}
+
+static void software_free(void *data) {
+    SoftwareBackend *software = data;
+
+    for(size_t i = 0; i < software->atlasCount; i++) {
+        UnloadImageColors(software->atlases[i].pixels);
+        unload_font_cpu(&software->fonts[i]);
+    }
+
+    UnloadImage(software->image);
+    batch_free(&software->batch);
+    memset(software, 0, sizeof(SoftwareBackend));
+}
+
+void software_backend_init(RenderBackend *backend, SoftwareBackend *software, int width) {
+    memset(software, 0, sizeof(SoftwareBackend));
+    software->width = width;
+    software->batch.overflow = software_overflow;
+    software->batch.overflowData = software;
+
+    *backend = (RenderBackend){
+        .name = "software",
+        .data = software,
+        .load_font = software_load_font,
+        .viewport_size = software_viewport_size,
+        .draw_text = software_draw_text,
+        .draw_circle = software_draw_circle,
+        .begin = software_begin,
+        .flush = software_flush,
+        .free = software_free,
+    };
+}
+
+void software_backend_begin(SoftwareBackend *software, int height, Color color) {
+    UnloadImage(software->image);
+    software->image = GenImageColor(software->width, height, color);
+}
+
+static bool recording_load_font(void *data, const char *fileName, int size, Font *font) {
+    RecordingBackend *recording = data;
+    if(recording->fontCount == RECORDING_BACKEND_MAX_FONTS) return false;
+
+    // only the glyphs are needed to measure the text
+    Image atlas;
+    if(!load_font_cpu(fileName, size, 0, font, &atlas)) return false;
+
+    UnloadImage(atlas);
+    recording->fonts[recording->fontCount++] = *font;
+    return true;
+}
+
+static void recording_viewport_size(void *data, int *width, int *height) {
+    RecordingBackend *recording = data;
+
+    *width = recording->width;
+    *height = recording->height;
+}
+
+static RecordedDraw *push_draw(RecordingBackend *recording) {
+    if(recording->count == recording->capacity) {
+        recording->capacity = recording->capacity == 0 ? 1024 : recording->capacity * 2;
+        recording->draws = realloc(recording->draws, recording->capacity * sizeof(RecordedDraw));
+    }
+
+    return &recording->draws[recording->count++];
+}
+
+static void recording_draw_text(
+    void *data, MeasureCache *cache,
+    const char *text, size_t size,
+    Vector2 pos, float fontSize, float spacing, Color color
+) {
+    (void)cache;
+    (void)spacing;
+
+    RecordingBackend *recording = data;
+
+    for(size_t i = 0; i < size;) {
+        size_t bytes;
+        int codepoint = utf8_next_codepoint(text + i, size - i, &bytes);
+        i += bytes;
+
+        // the batch doesn't emit quads for the spaces either
+        if(codepoint != ' ' && codepoint != '\t') recording->glyphs++;
+    }
+
+    if(recording->record) {
+        *push_draw(recording) = (RecordedDraw){
+            .type = RECORDED_TEXT,
+            .pos = pos,
+            .color = color,
+            .text = text,
+            .size = size,
+            .fontSize = fontSize,
+        };
+    }
+}
+
+static void recording_draw_circle(void *data, Vector2 center, float radius, Color color) {
+    RecordingBackend *recording = data;
+    recording->circles++;
+
+    if(recording->record) {
+        *push_draw(recording) = (RecordedDraw){
+            .type = RECORDED_CIRCLE,
+            .pos = center,
+            .color = color,
+            .radius = radius,
+        };
+    }
+}
+
+static void recording_begin(void *data, float top, float bottom) {
+    (void)data;
+    (void)top;
+    (void)bottom;
+}
+
+static void recording_flush(void *data, float top, float bottom) {
+    (void)top;
+    (void)bottom;
+
+    RecordingBackend *recording = data;
+    recording->flushes++;
+}
+
+static void recording_free(void *data) {
+    RecordingBackend *recording = data;
+
+    for(size_t i = 0; i < recording->fontCount; i++) {
+        unload_font_cpu(&recording->fonts[i]);
+    }
+
+    free(recording->draws);
+    memset(recording, 0, sizeof(RecordingBackend));
+}
+
+void recording_backend_init(RenderBackend *backend, RecordingBackend *recording, int width, int height, bool record) {
+    memset(recording, 0, sizeof(RecordingBackend));
+    recording->width = width;
+    recording->height = height;
+    recording->record = record;
+
+    *backend = (RenderBackend){
+        .name = "recording",
+        .data = recording,
+        .load_font = recording_load_font,
+        .viewport_size = recording_viewport_size,
+        .draw_text = recording_draw_text,
+        .draw_circle = recording_draw_circle,
+        .begin = recording_begin,
+        .flush = recording_flush,
+        .free = recording_free,
+    };
+}
+
+void recording_backend_clear(RecordingBackend *recording) {
+    recording->count = 0;
+    recording->glyphs = 0;
+    recording->circles = 0;
+    recording->flushes = 0;
+}
@@ -0,0 +1,108 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "batch.h"
+#include "measure.h"
+#include "raster.h"
+#include "raylib.h"
+
+// Everything the drawing code needs from the platform: the fonts (their glyphs are
+// what the layout measures with, see measure.h), the size of the viewport and a way
+// to draw text and shapes. The layout only depends on this, so it can run without a
+// GPU or a display with the software or the recording backends.
+typedef struct {
+    const char *name;
+    void *data;
+
+    // loads the font at size pixels, the font keeps the glyphs used to measure the text
+    bool (*load_font)(void *data, const char *fileName, int size, Font *font);
+    void (*viewport_size)(void *data, int *width, int *height);
+    // same as DrawTextEx, the text doesn't need to be null-terminated
+    void (*draw_text)(
+        void *data, MeasureCache *cache,
+        const char *text, size_t size,
+        Vector2 pos, float fontSize, float spacing, Color color
+    );
+    void (*draw_circle)(void *data, Vector2 center, float radius, Color color);
+    // the next draws are for the part of the target between top and bottom, the flush
+    // after them gets the same range
+    void (*begin)(void *data, float top, float bottom);
+    // the text and the shapes may be queued until this, top and bottom are the part of
+    // the target that they were drawn for
+    void (*flush)(void *data, float top, float bottom);
+    void (*free)(void *data);
+} RenderBackend;
+
+// draws with rlgl into the window, it has to be open before loading the fonts
+typedef struct {
+    RenderBatch batch;
+} RaylibBackend;
+
+#define SOFTWARE_BACKEND_MAX_FONTS 4
+
+// draws into an image on the CPU (see raster.h)
+typedef struct {
+    RenderBatch batch;
+    Image image; // allocated by software_backend_begin
+    int width;
+
+    // the atlases of the fonts stay in memory, the fonts only have a fake texture id
+    RasterTexture atlases[SOFTWARE_BACKEND_MAX_FONTS];
+    Font fonts[SOFTWARE_BACKEND_MAX_FONTS]; // to free their glyphs
+    size_t atlasCount;
+
+    float top, bottom; // range given to begin
+} SoftwareBackend;
+
+typedef enum {
+    RECORDED_TEXT,
+    RECORDED_CIRCLE,
+} RecordedDrawType;
+
+typedef struct {
+    RecordedDrawType type;
+    Vector2 pos; // center of the circles
+    Color color;
+
+    // only for RECORDED_TEXT, the text points into the document
+    const char *text;
+    size_t size;
+    float fontSize;
+
+    float radius; // only for RECORDED_CIRCLE
+} RecordedDraw;
+
+#define RECORDING_BACKEND_MAX_FONTS 4
+
+// doesn't draw anything, it only counts what would be drawn and, if record is true,
+// keeps a list of it, so the layout can be measured and checked without a display
+typedef struct {
+    int width, height;
+    bool record;
+
+    // the fonts that were loaded, to free their glyphs
+    Font fonts[RECORDING_BACKEND_MAX_FONTS];
+    size_t fontCount;
+
+    RecordedDraw *draws;
+    size_t count, capacity;
+
+    size_t glyphs;
+    size_t circles;
+    size_t flushes;
+} RecordingBackend;
+
+void raylib_backend_init(RenderBackend *backend, RaylibBackend *raylib);
+
+void software_backend_init(RenderBackend *backend, SoftwareBackend *software, int width);
+// allocates the image where the next flushes draw, filled with color
+void software_backend_begin(SoftwareBackend *software, int height, Color color);
+
+void recording_backend_init(RenderBackend *backend, RecordingBackend *recording, int width, int height, bool record);
+// forgets what was recorded, but keeps the memory
+void recording_backend_clear(RecordingBackend *recording);
+
+#endif // BACKEND_H
@@ -0,0 +1,187 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "rlgl.h"
+#include "stats.h"
+#include "utils.h"
+
+// same number of segments that DrawCircleV uses
+#define CIRCLE_SEGMENTS 36
+
+static BatchLayer *get_layer(RenderBatch *batch, Texture2D texture) {
+    for(size_t i = 0; i < batch->count; i++) {
+        if(batch->layers[i].texture.id == texture.id) return &batch->layers[i];
+    }
+
+    if(batch->count == BATCH_MAX_TEXTURES) {
+        // there's no room for another texture so what we have is drawn first
+        if(batch->overflow != NULL) {
+            batch->overflow(batch->overflowData);
+        } else {
+            batch_flush(batch);
+        }
+        batch->count = 0;
+    }
+
+    // the quads of the layer are kept to reuse their memory
+    BatchLayer *layer = &batch->layers[batch->count++];
+    layer->texture = texture;
+    layer->count = 0;
+    return layer;
+}
+
+static BatchQuad *push_quad(BatchLayer *layer) {
+    if(layer->count >= layer->capacity) {
+        layer->capacity = layer->capacity == 0 ? 1024 : layer->capacity * 2;
+        layer->quads = realloc(layer->quads, layer->capacity * sizeof(BatchQuad));
+    }
+
+    return &layer->quads[layer->count++];
+}
+
+static void push_rect(BatchLayer *layer, Rectangle dst, Rectangle src, Color color) {
+    Texture2D texture = layer->texture;
+    BatchQuad *quad = push_quad(layer);
+
+    float left = src.x / texture.width;
+    float right = (src.x + src.width) / texture.width;
+    float top = src.y / texture.height;
+    float bottom = (src.y + src.height) / texture.height;
+
+    quad->pos[0] = (Vector2){ dst.x, dst.y };
+    quad->uv[0] = (Vector2){ left, top };
+    quad->pos[1] = (Vector2){ dst.x, dst.y + dst.height };
+    quad->uv[1] = (Vector2){ left, bottom };
+    quad->pos[2] = (Vector2){ dst.x + dst.width, dst.y + dst.height };
+    quad->uv[2] = (Vector2){ right, bottom };
+    quad->pos[3] = (Vector2){ dst.x + dst.width, dst.y };
+    quad->uv[3] = (Vector2){ right, top };
+
+    quad->color = color;
+}
+
+void batch_text(
+    RenderBatch *batch, MeasureCache *cache,
+    const char *text, size_t size,
+    Vector2 pos, float fontSize, float spacing, Color color
+) {
+    Font font = cache->font;
+    BatchLayer *layer = get_layer(batch, font.texture);
+
+    float scaleFactor = fontSize / font.baseSize;
+    float padding = font.glyphPadding;
+    float offsetX = 0;
+    size_t glyphs = 0;
+
+    for(size_t i = 0; i < size;) {
+        size_t bytes;
+        int codepoint = utf8_next_codepoint(text + i, size - i, &bytes);
+        int index = measure_glyph_index(cache, codepoint);
+        i += bytes;
+
+        GlyphInfo glyph = font.glyphs[index];
+        Rectangle rec = font.recs[index];
+
+        // the same rectangles that DrawTextCodepoint uses
+        if(codepoint != ' ' && codepoint != '\t') {
+            Rectangle dst = {
+                pos.x + offsetX + (glyph.offsetX - padding) * scaleFactor,
+                pos.y + (glyph.offsetY - padding) * scaleFactor,
+                (rec.width + 2 * padding) * scaleFactor,
+                (rec.height + 2 * padding) * scaleFactor,
+            };
+            Rectangle src = {
+                rec.x - padding,
+                rec.y - padding,
+                rec.width + 2 * padding,
+                rec.height + 2 * padding,
+            };
+
+            push_rect(layer, dst, src, color);
+            glyphs++;
+        }
+
+        float advance = glyph.advanceX == 0 ? rec.width : glyph.advanceX;
+        offsetX += advance * scaleFactor + spacing;
+    }
+
+    stats_add(STATS_GLYPHS, glyphs);
+}
+
+void batch_circle(RenderBatch *batch, Vector2 center, float radius, Color color) {
+    Texture2D texture = GetShapesTexture();
+    Rectangle rec = GetShapesTextureRectangle();
+    BatchLayer *layer = get_layer(batch, texture);
+
+    float left = rec.x / texture.width;
+    float right = (rec.x + rec.width) / texture.width;
+    float top = rec.y / texture.height;
+    float bottom = (rec.y + rec.height) / texture.height;
+
+    float step = 360.0f / CIRCLE_SEGMENTS;
+    float angle = 0;
+
+    // like raylib, every quad covers two segments of the circle
+    for(int i = 0; i < CIRCLE_SEGMENTS / 2; i++) {
+        BatchQuad *quad = push_quad(layer);
+
+        quad->pos[0] = center;
+        quad->uv[0] = (Vector2){ left, top };
+        quad->pos[1] = (Vector2){
+            center.x + cosf(DEG2RAD * (angle + step * 2)) * radius,
+            center.y + sinf(DEG2RAD * (angle + step * 2)) * radius,
+        };
+        quad->uv[1] = (Vector2){ right, top };
+        quad->pos[2] = (Vector2){
+            center.x + cosf(DEG2RAD * (angle + step)) * radius,
+            center.y + sinf(DEG2RAD * (angle + step)) * radius,
+        };
+        quad->uv[2] = (Vector2){ right, bottom };
+        quad->pos[3] = (Vector2){
+            center.x + cosf(DEG2RAD * angle) * radius,
+            center.y + sinf(DEG2RAD * angle) * radius,
+        };
+        quad->uv[3] = (Vector2){ left, bottom };
+        quad->color = color;
+
+        angle += step * 2;
+    }
+}
+
+void batch_flush(RenderBatch *batch) {
+    for(size_t i = 0; i < batch->count; i++) {
+        BatchLayer *layer = &batch->layers[i];
+        if(layer->count == 0) continue;
+
+        // rlgl only starts a new draw call when the texture changes or its buffer is full
+        rlSetTexture(layer->texture.id);
+        rlBegin(RL_QUADS);
+        rlNormal3f(0, 0, 1);
+
+        for(size_t j = 0; j < layer->count; j++) {
+            BatchQuad *quad = &layer->quads[j];
+            rlColor4ub(quad->color.r, quad->color.g, quad->color.b, quad->color.a);
+
+            for(int k = 0; k < 4; k++) {
+                rlTexCoord2f(quad->uv[k].x, quad->uv[k].y);
+                rlVertex2f(quad->pos[k].x, quad->pos[k].y);
+            }
+        }
+
+        rlEnd();
+        rlSetTexture(0);
+        stats_add(STATS_DRAW_CALLS, 1);
+
+        layer->count = 0;
+    }
+}
+
+void batch_free(RenderBatch *batch) {
+    for(size_t i = 0; i < BATCH_MAX_TEXTURES; i++) {
+        free(batch->layers[i].quads);
+    }
+
+    memset(batch, 0, sizeof(RenderBatch));
+}
@@ -0,0 +1,49 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stddef.h>
+
+#include "measure.h"
+#include "raylib.h"
+
+#define BATCH_MAX_TEXTURES 4
+
+typedef struct {
+    Vector2 pos[4]; // top left, bottom left, bottom right, top right
+    Vector2 uv[4];
+    Color color;
+} BatchQuad;
+
+// quads that use the same texture
+typedef struct {
+    Texture2D texture;
+    BatchQuad *quads;
+    size_t count, capacity;
+} BatchLayer;
+
+// Collects the glyphs and shapes of a frame grouped by texture, so they are sent with
+// one draw per texture instead of one DrawTextEx or DrawCircle per item.
+typedef struct {
+    BatchLayer layers[BATCH_MAX_TEXTURES];
+    size_t count;
+
+    // draws what's queued when there's no room for another texture, so the backend that
+    // owns the batch draws it its own way, the batch is drawn through rlgl when it's NULL
+    void (*overflow)(void *data);
+    void *overflowData;
+} RenderBatch;
+
+// same result as DrawTextEx, the text doesn't need to be null-terminated
+void batch_text(
+    RenderBatch *batch, MeasureCache *cache,
+    const char *text, size_t size,
+    Vector2 pos, float fontSize, float spacing, Color color
+);
+// same result as DrawCircleV
+void batch_circle(RenderBatch *batch, Vector2 center, float radius, Color color);
+
+// draws every quad through rlgl and empties the batch
+void batch_flush(RenderBatch *batch);
+void batch_free(RenderBatch *batch);
+
+#endif // BATCH_H
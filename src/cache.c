@@ -0,0 +1,415 @@
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cache.h"
+#include "raylib.h"
+
+#define CACHE_MAGIC "MDCACHE"
+// sections of the cache file are aligned to this
+#define CACHE_ALIGNMENT 8
+
+typedef enum {
+    CACHE_SECTION_PATH,
+    CACHE_SECTION_TYPES,
+    CACHE_SECTION_FIRST_CHILD,
+    CACHE_SECTION_NEXT_SIBLING,
+    CACHE_SECTION_PAYLOAD,
+    CACHE_SECTION_SOURCE_START,
+    CACHE_SECTION_SOURCE_END,
+    CACHE_SECTION_HEADERS,
+    CACHE_SECTION_LISTS,
+    CACHE_SECTION_TEXTS,
+    CACHE_SECTION_WORDS,
+    CACHE_SECTION_STRINGS,
+    CACHE_SECTION_COUNT,
+} CacheSection;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    // sizes of the structs that are written as they are, a cache written by a
+    // different build isn't used
+    uint32_t layout;
+
+    uint64_t sourceSize;
+    int64_t mtimeSec;
+    int64_t mtimeNsec;
+    uint64_t sourceHash;
+
+    uint32_t pathSize;
+    uint32_t nodeCount;
+    uint32_t headerCount;
+    uint32_t listCount;
+    uint32_t textCount;
+    uint32_t wordCount;
+    uint32_t stringsSize;
+
+    uint64_t offsets[CACHE_SECTION_COUNT]; // from the start of the file
+} CacheHeader;
+
+#define CACHE_LAYOUT (sizeof(MDWord) | sizeof(FlatText) << 8 | sizeof(MDListNode) << 16 | sizeof(MDHeaderNode) << 24)
+
+// reads 8 bytes at a time, so hashing a big file costs a lot less than parsing it
+static uint64_t hash_bytes(const char *data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL ^ size;
+    size_t i = 0;
+
+    for(; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+        hash ^= hash >> 29;
+    }
+
+    for(; i < size; i++) {
+        hash = (hash ^ (unsigned char)data[i]) * 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+static bool cache_dir(char *dir, size_t size) {
+    const char *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+
+    int length;
+    if(xdg != NULL && xdg[0] != '\0') {
+        length = snprintf(dir, size, "%s/" CACHE_DIR_NAME, xdg);
+    } else if(home != NULL && home[0] != '\0') {
+        length = snprintf(dir, size, "%s/.cache/" CACHE_DIR_NAME, home);
+    } else {
+        return false;
+    }
+
+    return length > 0 && (size_t)length < size;
+}
+
+// the name of the cache file is the hash of the absolute path of the file
+static bool cache_file_path(const char *absPath, char *path, size_t size) {
+    char dir[PATH_MAX];
+    if(!cache_dir(dir, sizeof(dir))) return false;
+
+    unsigned long long hash = hash_bytes(absPath, strlen(absPath));
+    int length = snprintf(path, size, "%s/%016llx.bin", dir, hash);
+    return length > 0 && (size_t)length < size;
+}
+
+static size_t section_size(CacheHeader *header, CacheSection section) {
+    switch(section) {
+        case CACHE_SECTION_PATH: return header->pathSize;
+        case CACHE_SECTION_TYPES: return header->nodeCount * sizeof(uint8_t);
+        case CACHE_SECTION_FIRST_CHILD:
+        case CACHE_SECTION_NEXT_SIBLING:
+        case CACHE_SECTION_PAYLOAD:
+        case CACHE_SECTION_SOURCE_START:
+        case CACHE_SECTION_SOURCE_END:
+            return header->nodeCount * sizeof(uint32_t);
+        case CACHE_SECTION_HEADERS: return header->headerCount * sizeof(MDHeaderNode);
+        case CACHE_SECTION_LISTS: return header->listCount * sizeof(MDListNode);
+        case CACHE_SECTION_TEXTS: return header->textCount * sizeof(FlatText);
+        case CACHE_SECTION_WORDS: return header->wordCount * sizeof(MDWord);
+        case CACHE_SECTION_STRINGS: return header->stringsSize;
+        case CACHE_SECTION_COUNT: break;
+    }
+
+    return 0;
+}
+
+// the links have to make a tree that visits the nodes in the order they are stored,
+// otherwise a node could have several parents and be built and drawn more than once
+// the walk has its own stack because a crafted cache can be as deep as it has nodes
+static bool tree_is_preorder(MDFlatTree *tree) {
+    if(tree->nextSibling[0] != FLAT_TREE_NONE) return false;
+
+    // every node pushes at most its child and its next sibling
+    uint32_t *stack = malloc((tree->count + 1) * sizeof(uint32_t));
+    size_t depth = 0;
+    uint32_t visited = 0;
+    bool valid = true;
+
+    stack[depth++] = 0;
+
+    while(depth > 0) {
+        uint32_t node = stack[--depth];
+        if(node != visited) {
+            valid = false;
+            break;
+        }
+        visited++;
+
+        // the sibling is visited after the children
+        if(tree->nextSibling[node] != FLAT_TREE_NONE) stack[depth++] = tree->nextSibling[node];
+        if(tree->firstChild[node] != FLAT_TREE_NONE) stack[depth++] = tree->firstChild[node];
+    }
+
+    free(stack);
+    return valid && visited == tree->count;
+}
+
+// the cache could be truncated or corrupted, so every index is checked before
+// building the nodes from it
+static bool tree_is_valid(MDFlatTree *tree) {
+    if(tree->count == 0 || tree->types[0] != MD_DOCUMENT_NODE) return false;
+
+    for(uint32_t i = 0; i < tree->count; i++) {
+        if(tree->types[i] > MD_BOLD_NODE) return false;
+
+        // the nodes are in pre-order, so the links only go forward
+        uint32_t child = tree->firstChild[i];
+        uint32_t next = tree->nextSibling[i];
+        if(child != FLAT_TREE_NONE && (child <= i || child >= tree->count)) return false;
+        if(next != FLAT_TREE_NONE && (next <= i || next >= tree->count)) return false;
+
+        uint32_t payload = tree->payload[i];
+
+        switch(tree->types[i]) {
+            case MD_HEADER_NODE:
+                if(payload >= tree->headerCount) return false;
+                if(tree->headers[payload].level < 1 || tree->headers[payload].level > 6) return false;
+                break;
+            case MD_LIST_NODE:
+                if(payload >= tree->listCount) return false;
+                break;
+            case MD_TEXT_NODE: {
+                if(payload >= tree->textCount) return false;
+
+                FlatText *text = &tree->texts[payload];
+                uint64_t end = (uint64_t)text->offset + text->size;
+                if(end > (uint64_t)tree->sourceSize + tree->stringsSize) return false;
+                if(text->offset < tree->sourceSize && end > tree->sourceSize) return false;
+                if((uint64_t)text->firstWord + text->wordCount > tree->wordCount) return false;
+
+                for(uint32_t j = 0; j < text->wordCount; j++) {
+                    MDWord *word = &tree->words[text->firstWord + j];
+                    if((uint64_t)word->offset + word->length > text->size) return false;
+                }
+            } break;
+            default: break;
+        }
+    }
+
+    return tree_is_preorder(tree);
+}
+
+bool cache_load(const char *filePath, CachedDocument *doc) {
+    memset(doc, 0, sizeof(CachedDocument));
+
+    char absPath[PATH_MAX];
+    char cachePath[PATH_MAX];
+    struct stat st;
+
+    if(realpath(filePath, absPath) == NULL || stat(absPath, &st) != 0) return false;
+    if(!cache_file_path(absPath, cachePath, sizeof(cachePath))) return false;
+
+    int fd = open(cachePath, O_RDONLY);
+    if(fd == -1) return false;
+
+    struct stat cacheSt;
+    if(fstat(fd, &cacheSt) != 0 || (size_t)cacheSt.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        return false;
+    }
+
+    void *map = mmap(NULL, cacheSt.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) return false;
+
+    doc->map = map;
+    doc->mapSize = cacheSt.st_size;
+
+    CacheHeader *header = map;
+    size_t pathSize = strlen(absPath);
+
+    bool valid = memcmp(header->magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+        && header->version == CACHE_VERSION
+        && header->layout == CACHE_LAYOUT
+        && header->sourceSize == (uint64_t)st.st_size
+        && header->mtimeSec == (int64_t)st.st_mtim.tv_sec
+        && header->mtimeNsec == (int64_t)st.st_mtim.tv_nsec
+        && header->pathSize == pathSize;
+
+    for(CacheSection section = 0; valid && section < CACHE_SECTION_COUNT; section++) {
+        uint64_t offset = header->offsets[section];
+        valid = offset % CACHE_ALIGNMENT == 0
+            && offset <= doc->mapSize
+            && section_size(header, section) <= doc->mapSize - offset;
+    }
+
+    const char *base = map;
+    valid = valid && memcmp(base + header->offsets[CACHE_SECTION_PATH], absPath, pathSize) == 0;
+
+    // the modification time can stay the same after a change, so the content decides
+    valid = valid && read_file(absPath, &doc->source, true)
+        && doc->source.size == header->sourceSize
+        && hash_bytes(doc->source.data, doc->source.size) == header->sourceHash;
+
+    if(!valid) {
+        cache_close(doc);
+        return false;
+    }
+
+    MDFlatTree *tree = &doc->tree;
+    tree->types = (uint8_t *)(base + header->offsets[CACHE_SECTION_TYPES]);
+    tree->firstChild = (uint32_t *)(base + header->offsets[CACHE_SECTION_FIRST_CHILD]);
+    tree->nextSibling = (uint32_t *)(base + header->offsets[CACHE_SECTION_NEXT_SIBLING]);
+    tree->payload = (uint32_t *)(base + header->offsets[CACHE_SECTION_PAYLOAD]);
+    tree->sourceStart = (uint32_t *)(base + header->offsets[CACHE_SECTION_SOURCE_START]);
+    tree->sourceEnd = (uint32_t *)(base + header->offsets[CACHE_SECTION_SOURCE_END]);
+    tree->count = tree->capacity = header->nodeCount;
+    tree->headers = (MDHeaderNode *)(base + header->offsets[CACHE_SECTION_HEADERS]);
+    tree->headerCount = tree->headerCapacity = header->headerCount;
+    tree->lists = (MDListNode *)(base + header->offsets[CACHE_SECTION_LISTS]);
+    tree->listCount = tree->listCapacity = header->listCount;
+    tree->texts = (FlatText *)(base + header->offsets[CACHE_SECTION_TEXTS]);
+    tree->textCount = tree->textCapacity = header->textCount;
+    tree->words = (MDWord *)(base + header->offsets[CACHE_SECTION_WORDS]);
+    tree->wordCount = tree->wordCapacity = header->wordCount;
+    tree->strings = (char *)(base + header->offsets[CACHE_SECTION_STRINGS]);
+    tree->stringsSize = tree->stringsCapacity = header->stringsSize;
+    tree->source = doc->source.data;
+    tree->sourceSize = doc->source.size;
+
+    if(!tree_is_valid(tree)) {
+        TraceLog(LOG_WARNING, "CACHE: [%s] The cache is corrupted", cachePath);
+        cache_close(doc);
+        return false;
+    }
+
+    // the words and the texts are used from the map as they are, only the nodes are built
+    doc->arena = arena_create();
+    doc->docNode = flat_tree_to_nodes(tree, doc->arena);
+
+    TraceLog(LOG_INFO, "CACHE: [%s] Loaded %u nodes from the cache", filePath, tree->count);
+    return true;
+}
+
+void cache_close(CachedDocument *doc) {
+    if(doc->arena != NULL) arena_free(doc->arena);
+    if(doc->map != NULL) munmap(doc->map, doc->mapSize);
+    source_file_close(&doc->source);
+    memset(doc, 0, sizeof(CachedDocument));
+}
+
+static bool write_section(FILE *file, const void *data, size_t size) {
+    static const char padding[CACHE_ALIGNMENT] = {0};
+
+    if(size > 0 && fwrite(data, 1, size, file) != size) return false;
+
+    size_t rest = (CACHE_ALIGNMENT - size % CACHE_ALIGNMENT) % CACHE_ALIGNMENT;
+    return fwrite(padding, 1, rest, file) == rest;
+}
+
+static bool cache_save(CacheWriter *writer) {
+    char absPath[PATH_MAX];
+    char dir[PATH_MAX];
+    char cachePath[PATH_MAX];
+    char tmpPath[PATH_MAX + 32];
+    struct stat st;
+
+    if(realpath(writer->filePath, absPath) == NULL || stat(absPath, &st) != 0) return false;
+    if(!cache_dir(dir, sizeof(dir)) || !cache_file_path(absPath, cachePath, sizeof(cachePath))) return false;
+
+    // the parent of the directory may not exist either (e.g. ~/.cache)
+    char *slash = strrchr(dir, '/');
+    if(slash != NULL && slash != dir) {
+        *slash = '\0';
+        mkdir(dir, 0755);
+        *slash = '/';
+    }
+    mkdir(dir, 0755);
+
+    MDFlatTree tree;
+    flat_tree_init(&tree, writer->source, writer->sourceSize);
+    flat_tree_add_node(&tree, writer->docNode);
+
+    CacheHeader header = {
+        .version = CACHE_VERSION,
+        .layout = CACHE_LAYOUT,
+        .sourceSize = writer->sourceSize,
+        .mtimeSec = st.st_mtim.tv_sec,
+        .mtimeNsec = st.st_mtim.tv_nsec,
+        .sourceHash = hash_bytes(writer->source, writer->sourceSize),
+        .pathSize = strlen(absPath),
+        .nodeCount = tree.count,
+        .headerCount = tree.headerCount,
+        .listCount = tree.listCount,
+        .textCount = tree.textCount,
+        .wordCount = tree.wordCount,
+        .stringsSize = tree.stringsSize,
+    };
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+
+    const void *sections[CACHE_SECTION_COUNT] = {
+        [CACHE_SECTION_PATH] = absPath,
+        [CACHE_SECTION_TYPES] = tree.types,
+        [CACHE_SECTION_FIRST_CHILD] = tree.firstChild,
+        [CACHE_SECTION_NEXT_SIBLING] = tree.nextSibling,
+        [CACHE_SECTION_PAYLOAD] = tree.payload,
+        [CACHE_SECTION_SOURCE_START] = tree.sourceStart,
+        [CACHE_SECTION_SOURCE_END] = tree.sourceEnd,
+        [CACHE_SECTION_HEADERS] = tree.headers,
+        [CACHE_SECTION_LISTS] = tree.lists,
+        [CACHE_SECTION_TEXTS] = tree.texts,
+        [CACHE_SECTION_WORDS] = tree.words,
+        [CACHE_SECTION_STRINGS] = tree.strings,
+    };
+
+    uint64_t offset = sizeof(CacheHeader);
+    for(CacheSection section = 0; section < CACHE_SECTION_COUNT; section++) {
+        header.offsets[section] = offset;
+
+        size_t size = section_size(&header, section);
+        offset += size + (CACHE_ALIGNMENT - size % CACHE_ALIGNMENT) % CACHE_ALIGNMENT;
+    }
+
+    // the cache is written to another file and renamed, so a reader never sees half of it
+    snprintf(tmpPath, sizeof(tmpPath), "%s.%d.tmp", cachePath, (int)getpid());
+
+    FILE *file = fopen(tmpPath, "wb");
+    bool ok = file != NULL && write_section(file, &header, sizeof(CacheHeader));
+
+    for(CacheSection section = 0; ok && section < CACHE_SECTION_COUNT; section++) {
+        ok = write_section(file, sections[section], section_size(&header, section));
+    }
+
+    if(file != NULL && fclose(file) != 0) ok = false;
+
+    if(ok && rename(tmpPath, cachePath) != 0) ok = false;
+    if(!ok) unlink(tmpPath);
+
+    flat_tree_free(&tree);
+    return ok;
+}
+
+static void *cache_save_worker(void *arg) {
+    CacheWriter *writer = arg;
+
+    if(!cache_save(writer)) {
+        TraceLog(LOG_WARNING, "CACHE: [%s] Couldn't save the cache", writer->filePath);
+    }
+
+    return NULL;
+}
+
+void cache_save_start(CacheWriter *writer, const char *filePath, MDNode *docNode, const char *source, size_t sourceSize) {
+    memset(writer, 0, sizeof(CacheWriter));
+    writer->filePath = strdup(filePath);
+    writer->docNode = docNode;
+    writer->source = source;
+    writer->sourceSize = sourceSize;
+
+    writer->started = pthread_create(&writer->thread, NULL, cache_save_worker, writer) == 0;
+}
+
+void cache_save_finish(CacheWriter *writer) {
+    if(writer->started) pthread_join(writer->thread, NULL);
+
+    free(writer->filePath);
+    memset(writer, 0, sizeof(CacheWriter));
+}
@@ -0,0 +1,51 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+#include "flattree.h"
+#include "nodes.h"
+#include "parser.h"
+#include "utils.h"
+
+// The parsed tree of a file is saved as a flat tree (see flattree.h) in the cache
+// directory, so the next time the file is opened the cache is mapped instead of parsing
+// the file. It's only used if the path, size, modification time and hash of the file
+// are the same as when it was saved.
+
+#define CACHE_DIR_NAME "c-markdown-renderer"
+#define CACHE_VERSION 1
+
+typedef struct {
+    SourceFile source; // the text nodes point into it
+
+    void *map; // mapping of the cache file
+    size_t mapSize;
+    MDFlatTree tree; // its arrays point into the map
+
+    Arena *arena; // memory for the nodes
+    MDNode *docNode;
+} CachedDocument;
+
+// saves the cache in its own thread so the window isn't blocked
+typedef struct {
+    pthread_t thread;
+    bool started;
+
+    char *filePath;
+    MDNode *docNode;
+    const char *source;
+    size_t sourceSize;
+} CacheWriter;
+
+// returns false if there's no valid cache for the file
+bool cache_load(const char *filePath, CachedDocument *doc);
+void cache_close(CachedDocument *doc);
+
+// the document and the source can't change until cache_save_finish returns
+void cache_save_start(CacheWriter *writer, const char *filePath, MDNode *docNode, const char *source, size_t sourceSize);
+// waits until the cache is written
+void cache_save_finish(CacheWriter *writer);
+
+#endif // CACHE_H
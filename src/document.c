@@ -0,0 +1,348 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "document.h"
+#include "split.h"
+
+static SourceBuffer *source_buffer_read(const char *filePath) {
+    SourceBuffer *buffer = malloc(sizeof(SourceBuffer));
+    buffer->refs = 0;
+
+    // the file is copied instead of mapped since editors can write it in place,
+    // and the segments that didn't change still point into the old versions
+    if(!read_file(filePath, &buffer->file, false)) {
+        free(buffer);
+        return NULL;
+    }
+
+    return buffer;
+}
+
+static void source_buffer_release(SourceBuffer *buffer) {
+    buffer->refs--;
+
+    if(buffer->refs == 0) {
+        source_file_close(&buffer->file);
+        free(buffer);
+    }
+}
+
+static void parse_segment(Document *doc, DocSegment *segment) {
+    ParserData data = {
+        .arena = arena_create(),
+        .context = doc->parser,
+    };
+
+    parse_text(&data, segment->buffer->file.data + segment->start, segment->size);
+
+    segment->arena = data.arena;
+
+    if(data.docNode != NULL) {
+        segment->first = data.docNode->children.head;
+        segment->last = data.docNode->children.tail;
+        segment->count = data.docNode->children.count;
+    }
+}
+
+static void free_segment(DocSegment *segment) {
+    arena_free(segment->arena);
+    source_buffer_release(segment->buffer);
+}
+
+// index of the last segment that starts at or before offset
+static size_t find_segment(Document *doc, size_t offset) {
+    size_t low = 0, high = doc->count;
+
+    while(low < high) {
+        size_t mid = low + (high - low) / 2;
+
+        if(doc->segments[mid].start <= offset) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low == 0 ? 0 : low - 1;
+}
+
+// replaces the segments [first, end) with the ones found in [newStart, newEnd) of the
+// buffer, the segments after them are moved by delta bytes
+static void replace_segments(
+    Document *doc, SourceBuffer *buffer,
+    size_t first, size_t end,
+    size_t newStart, size_t newEnd, ptrdiff_t delta,
+    DocumentChange *change
+) {
+    size_t newCapacity = 16;
+    size_t newCount = 0;
+    DocSegment *newSegments = malloc(newCapacity * sizeof(DocSegment));
+
+    const char *text = buffer->file.data;
+    size_t pos = newStart;
+
+    while(pos < newEnd) {
+        size_t boundary = doc->hasRefDefs ? newEnd : split_next_boundary(text, newEnd, pos);
+
+        if(newCount == newCapacity) {
+            newCapacity *= 2;
+            newSegments = realloc(newSegments, newCapacity * sizeof(DocSegment));
+        }
+
+        DocSegment *segment = &newSegments[newCount++];
+        memset(segment, 0, sizeof(DocSegment));
+        segment->start = pos;
+        segment->size = boundary - pos;
+        segment->buffer = buffer;
+        buffer->refs++;
+
+        parse_segment(doc, segment);
+
+        pos = boundary;
+    }
+
+    // the buffers are only kept while a change is parsed, they can be as big as the file
+    if(doc->parser != NULL) parser_context_reset(doc->parser);
+
+    // find the blocks around the replaced ones
+    MDNode *prevNode = NULL;
+    for(size_t i = first; i > 0 && prevNode == NULL; i--) {
+        prevNode = doc->segments[i - 1].last;
+    }
+
+    MDNode *nextNode = NULL;
+    for(size_t i = end; i < doc->count && nextNode == NULL; i++) {
+        nextNode = doc->segments[i].first;
+    }
+
+    change->index = 0;
+    for(size_t i = 0; i < first; i++) {
+        change->index += doc->segments[i].count;
+    }
+
+    change->removed = 0;
+    for(size_t i = first; i < end; i++) {
+        change->removed += doc->segments[i].count;
+        free_segment(&doc->segments[i]);
+    }
+
+    // link the new blocks between the old ones
+    change->added = 0;
+    MDNode *tail = prevNode;
+    for(size_t i = 0; i < newCount; i++) {
+        DocSegment *segment = &newSegments[i];
+        if(segment->count == 0) continue;
+
+        if(tail == NULL) {
+            doc->docNode.children.head = segment->first;
+        } else {
+            tail->next = segment->first;
+        }
+
+        tail = segment->last;
+        change->added += segment->count;
+    }
+
+    if(tail == NULL) {
+        doc->docNode.children.head = nextNode;
+    } else {
+        tail->next = nextNode;
+    }
+
+    if(nextNode == NULL) {
+        doc->docNode.children.tail = tail;
+    }
+
+    doc->docNode.children.count += change->added;
+    doc->docNode.children.count -= change->removed;
+
+    // the segments after the change keep their nodes, they only move in the file
+    for(size_t i = end; i < doc->count; i++) {
+        doc->segments[i].start += delta;
+    }
+
+    size_t count = doc->count - (end - first) + newCount;
+    if(count > doc->capacity) {
+        doc->capacity = count * 2;
+        doc->segments = realloc(doc->segments, doc->capacity * sizeof(DocSegment));
+    }
+
+    memmove(
+        &doc->segments[first + newCount],
+        &doc->segments[end],
+        (doc->count - end) * sizeof(DocSegment)
+    );
+    memcpy(&doc->segments[first], newSegments, newCount * sizeof(DocSegment));
+    doc->count = count;
+
+    free(newSegments);
+}
+
+bool document_load(Document *doc, const char *filePath) {
+    memset(doc, 0, sizeof(Document));
+    doc->docNode.type = MD_DOCUMENT_NODE;
+
+    SourceBuffer *buffer = source_buffer_read(filePath);
+    if(buffer == NULL) return false;
+
+    doc->source = buffer;
+    buffer->refs++;
+
+    doc->parser = parser_context_create();
+    doc->hasRefDefs = split_has_ref_defs(buffer->file.data, buffer->file.size);
+
+    DocumentChange change;
+    replace_segments(doc, buffer, 0, 0, 0, buffer->file.size, 0, &change);
+
+    return true;
+}
+
+bool document_reload(Document *doc, const char *filePath, DocumentChange *change) {
+    SourceBuffer *buffer = source_buffer_read(filePath);
+    if(buffer == NULL) return false;
+
+    buffer->refs++;
+
+    const char *oldText = doc->source->file.data;
+    size_t oldSize = doc->source->file.size;
+    const char *newText = buffer->file.data;
+    size_t newSize = buffer->file.size;
+
+    size_t minSize = oldSize < newSize ? oldSize : newSize;
+
+    size_t prefix = 0;
+    while(prefix < minSize && oldText[prefix] == newText[prefix]) prefix++;
+
+    if(prefix == oldSize && prefix == newSize) {
+        source_buffer_release(buffer);
+        return false;
+    }
+
+    size_t suffix = 0;
+    while(suffix < minSize - prefix && oldText[oldSize - suffix - 1] == newText[newSize - suffix - 1]) {
+        suffix++;
+    }
+
+    bool hadRefDefs = doc->hasRefDefs;
+    doc->hasRefDefs = split_has_ref_defs(newText, newSize);
+
+    ptrdiff_t delta = (ptrdiff_t)newSize - (ptrdiff_t)oldSize;
+
+    size_t first = 0;
+    size_t end = doc->count;
+    size_t newStart = 0;
+    size_t newEnd = newSize;
+
+    if(!hadRefDefs && !doc->hasRefDefs && doc->count > 0) {
+        // the segment before the changed one is parsed again too, since the edit
+        // can make the boundary between them not safe anymore
+        first = find_segment(doc, prefix > 0 ? prefix - 1 : 0);
+        if(first > 0) first--;
+        newStart = doc->segments[first].start;
+
+        // look for the first boundary after the change that was already a boundary,
+        // from there the text and the state of the splitter are the same as before
+        size_t changedEnd = newSize - suffix;
+        size_t pos = newStart;
+
+        while(pos < newSize) {
+            pos = split_next_boundary(newText, newSize, pos);
+            if(pos < changedEnd || pos == newSize) continue;
+
+            size_t oldPos = pos - delta;
+            size_t i = find_segment(doc, oldPos);
+
+            if(i > first && doc->segments[i].start == oldPos) {
+                end = i;
+                newEnd = pos;
+                break;
+            }
+        }
+    }
+
+    replace_segments(doc, buffer, first, end, newStart, newEnd, delta, change);
+
+    source_buffer_release(doc->source);
+    doc->source = buffer;
+
+    return true;
+}
+
+static bool nodes_equal(MDNode *a, MDNode *b) {
+    if(a->type != b->type || a->children.count != b->children.count) return false;
+
+    switch(a->type) {
+        case MD_HEADER_NODE:
+            if(a->header.level != b->header.level) return false;
+            break;
+        case MD_LIST_NODE:
+            if(a->list.ordered != b->list.ordered || a->list.startIndex != b->list.startIndex) return false;
+            break;
+        case MD_TEXT_NODE:
+            if(a->text.size != b->text.size || memcmp(a->text.data, b->text.data, a->text.size) != 0) return false;
+            if(a->text.wordCount != b->text.wordCount) return false;
+            break;
+        default: break;
+    }
+
+    MDNode *childA = a->children.head;
+    MDNode *childB = b->children.head;
+
+    for(; childA != NULL && childB != NULL; childA = childA->next, childB = childB->next) {
+        if(!nodes_equal(childA, childB)) return false;
+    }
+
+    return childA == NULL && childB == NULL;
+}
+
+bool document_check(Document *doc) {
+    const char *text = doc->source->file.data;
+    size_t size = doc->source->file.size;
+
+    // the segments have to start where a split of the whole text would start them
+    if(!doc->hasRefDefs) {
+        size_t pos = 0;
+
+        for(size_t i = 0; i < doc->count; i++) {
+            if(doc->segments[i].start != pos) return false;
+            pos = split_next_boundary(text, size, pos);
+        }
+
+        if(pos != size) return false;
+    }
+
+    ParserData data = {
+        .arena = arena_create(),
+        .context = doc->parser,
+    };
+
+    int result = parse_text(&data, text, size);
+    if(doc->parser != NULL) parser_context_reset(doc->parser);
+
+    bool equal = data.docNode != NULL;
+    MDNode *node = equal ? data.docNode->children.head : NULL;
+    MDNode *block = doc->docNode.children.head;
+
+    for(; equal && node != NULL; node = node->next, block = block->next) {
+        equal = block != NULL && nodes_equal(node, block);
+    }
+
+    // a parse that fails stops at the error, the segments after it still have blocks
+    if(result == 0 && block != NULL) equal = false;
+
+    arena_free(data.arena);
+    return equal;
+}
+
+void document_free(Document *doc) {
+    for(size_t i = 0; i < doc->count; i++) {
+        free_segment(&doc->segments[i]);
+    }
+
+    free(doc->segments);
+
+    if(doc->source != NULL) source_buffer_release(doc->source);
+    if(doc->parser != NULL) parser_context_free(doc->parser);
+
+    memset(doc, 0, sizeof(Document));
+}
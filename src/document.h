@@ -0,0 +1,58 @@
+#ifndef DOCUMENT_H
+#define DOCUMENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "nodes.h"
+#include "parser.h"
+#include "utils.h"
+
+// content of a version of the file, shared by the segments parsed from it
+typedef struct {
+    SourceFile file;
+    size_t refs;
+} SourceBuffer;
+
+// text between two safe boundaries (see split.h), parsed on its own
+typedef struct {
+    size_t start, size; // range in the current version of the file
+
+    SourceBuffer *buffer; // the text nodes of the segment point into it
+    Arena *arena; // memory for the nodes of the segment
+
+    // top-level blocks of the segment, they are consecutive in the document
+    MDNode *first, *last;
+    size_t count;
+} DocSegment;
+
+// document that can be parsed again only where the file changed
+typedef struct {
+    MDNode docNode;
+
+    SourceBuffer *source; // latest version of the file
+    bool hasRefDefs; // then the document can't be split since the definitions are global
+
+    DocSegment *segments;
+    size_t count, capacity;
+
+    // a file has a lot of small segments, they are parsed with the same md4c buffers
+    MD_PARSER_CTX *parser;
+} Document;
+
+// the top-level blocks [index, index + removed) were replaced by added new ones
+typedef struct {
+    size_t index;
+    size_t removed;
+    size_t added;
+} DocumentChange;
+
+bool document_load(Document *doc, const char *filePath);
+// returns false if the file couldn't be read or it didn't change
+bool document_reload(Document *doc, const char *filePath, DocumentChange *change);
+// parses the whole file again and compares it with the segments, for debugging the
+// reloads, it's as slow as a full parse
+bool document_check(Document *doc);
+void document_free(Document *doc);
+
+#endif // DOCUMENT_H
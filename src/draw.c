@@ -1,209 +1,206 @@
-#include <string.h>
-#include <stdio.h>
+#include <float.h>
+#include <math.h>
 
 #include "draw.h"
+#include "layout.h"
 #include "raylib.h"
-
-#define SCREEN_PADDING 20 // separation between the content and the screen
-#define DEFAULT_FONT_SIZE 20
-#define DEFAULT_PADDING_BETWEEN_BLOCKS 20
-
-#define LIST_DOT_RADIUS 2
-#define LIST_LEFT_PADDING 20
-// padding between list items
-#define LIST_ITEM_PADDING 10
-#define LIST_PADDING_AFTER_MARK 10
+#include "redraw.h"
+#include "stats.h"
+#include "tiles.h"
+#include "trace.h"
 
 #define FONT_NORMAL_FILE "./fonts/JetBrainsMono-Regular.ttf"
 #define FONT_BOLD_FILE "./fonts/JetBrainsMono-Bold.ttf"
+#define FONT_SIZE 50
 
-const int HEADER_FONT_SIZES[] = {
-    DEFAULT_FONT_SIZE * 2, // level 1
-    DEFAULT_FONT_SIZE * 1.75, // level 2
-    DEFAULT_FONT_SIZE * 1.5, // level 3
-    DEFAULT_FONT_SIZE * 1.25, // level 4
-    DEFAULT_FONT_SIZE * 1, // level 5
-    DEFAULT_FONT_SIZE * 0.8, // level 6
-};
-
-typedef enum {
-    FONT_WEIGHT_NORMAL,
-    FONT_WEIGHT_BOLD,
-} FontWeight;
+#define TEXT_SPACING 2
 
 typedef struct {
-    Vector2 pos; // drawing current pos
-    float prevHeight;
-
-    struct {
-        Font normal;
-        Font bold;
-    } fonts;
+    RenderBackend *backend;
+    LayoutFonts fonts;
+    Layout layout;
+    TileCache tiles;
 } DrawCtx;
 
-typedef struct {
-    int fontSize;
-
-    // this padding will be used to separate the content from the borders of the screen
-    struct {
-        int left;
-        int right;
-    } padding;
+DrawCtx ctx = {0};
 
-    int paddingBetweenBlocks;
+static void draw_item(LayoutItem *item, float blockY) {
+    RenderBackend *backend = ctx.backend;
+    Vector2 pos = { item->pos.x, item->pos.y + blockY };
+
+    switch(item->type) {
+        case LAYOUT_ITEM_TEXT: {
+            MeasureCache *cache = item->text.weight == FONT_WEIGHT_NORMAL ? &ctx.fonts.normalCache : &ctx.fonts.boldCache;
+            backend->draw_text(backend->data, cache, item->text.str, item->text.size, pos, item->text.fontSize, TEXT_SPACING, item->color);
+        } break;
+        case LAYOUT_ITEM_CIRCLE: {
+            // DrawCircle used integer coordinates
+            Vector2 center = { (int)pos.x, (int)(pos.y + (int)item->height / 2) };
+            backend->draw_circle(backend->data, center, item->radius, item->color);
+        } break;
+    }
+}
 
-    FontWeight weight;
-} DrawStyle;
+bool draw_init(RenderBackend *backend) {
+    ctx.backend = backend;
+    int64_t start = stats_now();
 
-DrawCtx ctx = {0};
+    if(!backend->load_font(backend->data, FONT_NORMAL_FILE, FONT_SIZE, &ctx.fonts.normal)) return false;
+    if(!backend->load_font(backend->data, FONT_BOLD_FILE, FONT_SIZE, &ctx.fonts.bold)) return false;
 
-static void draw_node(MDNode *node, DrawStyle style);
+    measure_cache_init(&ctx.fonts.normalCache, ctx.fonts.normal);
+    measure_cache_init(&ctx.fonts.boldCache, ctx.fonts.bold);
 
-static void draw_node_children(MDNodeList children, DrawStyle style) {
-    MDNode *child = children.head;
-    while(child != NULL) {
-        draw_node(child, style);
-        child = child->next;
-    }
+    trace_event("draw", "load fonts", start);
+    return true;
 }
 
-static void draw_word(const char *word, DrawStyle style, Color color) {
-    float spacing = 2;
+// adds the items between top and bottom to the batch, in document coordinates
+static void draw_region(float top, float bottom) {
+    int64_t start = stats_now();
+    ctx.backend->begin(ctx.backend->data, top, bottom);
 
-    Font font = style.weight == FONT_WEIGHT_NORMAL ? ctx.fonts.normal : ctx.fonts.bold;
+    size_t i = layout_find_block(&ctx.layout, top);
+    float y = layout_block_y(&ctx.layout, i);
 
-    Vector2 textSize = MeasureTextEx(font, word, style.fontSize, spacing);
-    int padding = style.padding.left + style.padding.right;
+    int64_t culled = stats_now();
+    stats_add_time(STATS_CULL, culled - start);
 
-    if(ctx.pos.x + textSize.x > GetScreenWidth() - padding) {
-        ctx.pos.x = style.padding.left;
-        ctx.pos.y += style.fontSize;
+    for(; i < ctx.layout.count && y <= bottom; i++) {
+        LayoutBlock *block = &ctx.layout.blocks[i];
+        LayoutFlow *flow = block->flow;
+
+        // the blocks that weren't laid out only have a height
+        if(flow != NULL) {
+            for(size_t j = layout_find_item(flow, top - y); j < flow->count; j++) {
+                LayoutItem *item = &flow->items[j];
+                if(y + item->pos.y > bottom) break;
+
+                draw_item(item, y);
+            }
+        }
+
+        y += block->height;
     }
 
-    DrawTextEx(font, word, ctx.pos, style.fontSize, spacing, color);
+    stats_add_time(STATS_DRAW, stats_now() - culled);
+}
 
-    ctx.pos.x += textSize.x;
+static void flush_region(float top, float bottom) {
+    int64_t start = stats_now();
+    ctx.backend->flush(ctx.backend->data, top, bottom);
+    stats_add_time(STATS_DRAW, stats_now() - start);
 }
 
-static void draw_text_node(MDNode *textNode, DrawStyle style) {
-    static char word[1024];
+static void draw_tile(Tile *tile) {
+    float top = tile->index * TILE_HEIGHT;
+    Camera2D camera = {
+        .target = { 0, top },
+        .zoom = 1,
+    };
 
-    Color color = WHITE;
+    BeginTextureMode(tile->target);
+    ClearBackground(BACKGROUND_COLOR);
 
-    size_t prevStart = 0;
-    for(size_t i = 0; i < strlen(textNode->text); i++) {
-        if(textNode->text[i] == ' ') {
-            size_t size = i - prevStart + 1;
-            strncpy(word, textNode->text + prevStart, size);
-            word[size] = '\0';
-            prevStart = i + 1;
-            draw_word(word, style, color);
-        }
-    }
+    BeginMode2D(camera);
+    draw_region(top, top + TILE_HEIGHT);
+    flush_region(top, top + TILE_HEIGHT);
+    EndMode2D();
 
-    size_t size = strlen(textNode->text) - prevStart;
-    strncpy(word, textNode->text + prevStart, size);
-    word[size] = '\0';
-    draw_word(word, style, color);
+    EndTextureMode();
 }
 
-static void draw_list_node(MDNode *listNode, DrawStyle style) {
-    style.padding.left += LIST_LEFT_PADDING;
+float draw_layout_view(MDNode *docNode, float top, float bottom) {
+    int width, height;
+    ctx.backend->viewport_size(ctx.backend->data, &width, &height);
 
-    ctx.pos.x = style.padding.left;
-    ctx.pos.y += ctx.prevHeight + style.paddingBetweenBlocks;
+    int64_t start = stats_now();
 
-    MDNode *listItem = listNode->children.head;
+    // the layout is only started again when the document or the width changes
+    layout_update(&ctx.layout, docNode, &ctx.fonts, width);
+    float shift = layout_prepare(&ctx.layout, top, bottom);
 
-    size_t i = 0;
+    stats_add_time(STATS_LAYOUT, stats_now() - start);
 
-    while(listItem != NULL) {
-        if(i > 0) {
-            ctx.pos.x = style.padding.left;
-            ctx.pos.y += style.fontSize + LIST_ITEM_PADDING;
-        }
+    if(ctx.layout.changedY != FLT_MAX) redraw_invalidate();
 
-        if(listNode->list.ordered) {
-            static char listMark[20];
-            snprintf(listMark, 20, "%lu.", i + listNode->list.startIndex);
-            draw_word(listMark, style, WHITE);
-            ctx.pos.x += LIST_PADDING_AFTER_MARK;
-        } else {
-            DrawCircle(ctx.pos.x, ctx.pos.y + style.fontSize / 2, LIST_DOT_RADIUS, WHITE);
-            ctx.pos.x += LIST_PADDING_AFTER_MARK;
-        }
+    return shift;
+}
 
+void draw_document_node(MDNode *docNode, Camera2D camera) {
+    // part of the document that the camera is showing
+    float top = GetScreenToWorld2D((Vector2){0, 0}, camera).y;
+    float bottom = GetScreenToWorld2D((Vector2){0, GetScreenHeight()}, camera).y;
 
-        DrawStyle localStyle = style;
-        localStyle.padding.left += LIST_PADDING_AFTER_MARK;
-        localStyle.paddingBetweenBlocks = LIST_ITEM_PADDING;
+    // usually the view was already laid out, then this doesn't do anything
+    draw_layout_view(docNode, top, bottom);
 
-        draw_node_children(listItem->children, localStyle);
+    int64_t start = stats_now();
+    tile_cache_begin(&ctx.tiles, ctx.layout.width, ctx.layout.changedY);
+    ctx.layout.changedY = FLT_MAX;
+    stats_add_time(STATS_CULL, stats_now() - start);
 
-        listItem = listItem->next;
-        i++;
-    }
+    int64_t first = floorf(top / TILE_HEIGHT);
+    int64_t last = floorf(bottom / TILE_HEIGHT);
 
-    ctx.prevHeight = style.fontSize;
-}
+    // the tiles are drawn before setting the camera since the texture mode resets it
+    Tile *tiles[TILE_CACHE_SIZE];
+    size_t count = 0;
 
-static void draw_node(MDNode *node, DrawStyle style) {
-    switch(node->type) {
-        case MD_DOCUMENT_NODE:
-            draw_node_children(node->children, style);
-            break;
-        case MD_HEADER_NODE:
-            ctx.pos.x = style.padding.left;
-            ctx.pos.y += ctx.prevHeight + style.paddingBetweenBlocks;
+    for(int64_t i = first; i <= last; i++) {
+        bool fresh;
+        start = stats_now();
+        Tile *tile = count < TILE_CACHE_SIZE ? tile_cache_get(&ctx.tiles, i, &fresh) : NULL;
+        stats_add_time(STATS_CULL, stats_now() - start);
 
-            style.fontSize = HEADER_FONT_SIZES[node->header.level - 1];
-            draw_node_children(node->children, style);
-            ctx.prevHeight = style.fontSize;
-            break;
-        case MD_TEXT_NODE:
-            draw_text_node(node, style);
-            break;
-        case MD_P_NODE:
-            ctx.pos.x = style.padding.left;
-            ctx.pos.y += ctx.prevHeight + style.paddingBetweenBlocks;
-            draw_node_children(node->children, style);
-            ctx.prevHeight = style.fontSize;
-            break;
-        case MD_LIST_NODE: draw_list_node(node, style); break;
-        // ignore it since it will be handled by MD_LIST_NODE case
-        case MD_LIST_ITEM_NODE: break;
-        case MD_BOLD_NODE:
-            style.weight = FONT_WEIGHT_BOLD;
-            draw_node_children(node->children, style);
+        if(tile == NULL) {
+            // the window is taller than the cache, so it's drawn without tiles
+            count = 0;
             break;
+        }
+
+        if(fresh) draw_tile(tile);
+        tiles[count++] = tile;
     }
+
+    BeginMode2D(camera);
+
+    if(count == 0) {
+        draw_region(top, bottom);
+        flush_region(top, bottom);
+    }
+
+    start = stats_now();
+
+    for(size_t i = 0; i < count; i++) {
+        // the render textures are upside down
+        Rectangle source = { 0, 0, ctx.tiles.width, -TILE_HEIGHT };
+        Vector2 pos = { 0, tiles[i]->index * TILE_HEIGHT };
+        DrawTextureRec(tiles[i]->target.texture, source, pos, WHITE);
+    }
+
+    EndMode2D();
+
+    // every tile has its own texture, so each one is a draw call
+    stats_add(STATS_DRAW_CALLS, count);
+    stats_add_time(STATS_DRAW, stats_now() - start);
 }
 
-void draw_init() {
-    ctx.fonts.normal = LoadFontEx(FONT_NORMAL_FILE, 50, NULL, 0);
-    SetTextureFilter(ctx.fonts.normal.texture, TEXTURE_FILTER_BILINEAR);
+void draw_document_region(MDNode *docNode, float top, float bottom) {
+    draw_layout_view(docNode, top, bottom);
 
-    ctx.fonts.bold = LoadFontEx(FONT_BOLD_FILE, 50, NULL, 0);
-    SetTextureFilter(ctx.fonts.bold.texture, TEXTURE_FILTER_BILINEAR);
+    draw_region(top, bottom);
+    flush_region(top, bottom);
 }
 
-void draw_document_node(MDNode *docNode) {
-    // reset ctx
-    ctx.pos.x = SCREEN_PADDING;
-
-    // here we substract the padding since every node adds it before drawing
-    ctx.pos.y = SCREEN_PADDING - DEFAULT_PADDING_BETWEEN_BLOCKS;
-    ctx.prevHeight = 0;
-
-    DrawStyle style = {
-        .fontSize = DEFAULT_FONT_SIZE,
-        .padding = {
-            .left = SCREEN_PADDING,
-            .right = SCREEN_PADDING,
-        },
-        .paddingBetweenBlocks = DEFAULT_PADDING_BETWEEN_BLOCKS,
-        .weight = FONT_WEIGHT_NORMAL,
-    };
+float draw_document_height() {
+    return ctx.layout.height + SCREEN_PADDING;
+}
+
+void draw_unload_document() {
+    layout_free(&ctx.layout);
+}
 
-    draw_node(docNode, style);
+void draw_splice_blocks(size_t index, size_t removed, size_t added) {
+    layout_splice(&ctx.layout, index, removed, added);
 }
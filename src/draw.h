@@ -1,9 +1,34 @@
 #ifndef DRAW_H
 #define DRAW_H
 
+#include <stdbool.h>
+
+#include "backend.h"
 #include "nodes.h"
+#include "raylib.h"
+
+#define BACKGROUND_COLOR BLACK
 
-void draw_init();
-void draw_document_node(MDNode *docNode);
+// everything is drawn through the backend, it has to outlive the drawing
+// returns false if the fonts couldn't be loaded
+bool draw_init(RenderBackend *backend);
+// lays out the part of the document between top and bottom, the blocks far from it
+// only have an estimated height. Returns how much the content above top moved
+float draw_layout_view(MDNode *docNode, float top, float bottom);
+// only draws the part of the document that is visible through the camera, the camera
+// is set here so it must not be active when this is called
+// the visible part is cached in textures, so it only works with the raylib backend
+void draw_document_node(MDNode *docNode, Camera2D camera);
+// lays out and draws the part of the document between top and bottom, in document
+// coordinates, without any cache. It works with every backend
+void draw_document_region(MDNode *docNode, float top, float bottom);
+// height of the document laid out by the last draw, with the padding at the bottom
+float draw_document_height();
+// forgets the layout of the document, it has to be called before freeing a document
+// that was drawn, since a new one can get the same address
+void draw_unload_document();
+// tells the cached layout that the top-level blocks [index, index + removed) were
+// replaced by added new ones
+void draw_splice_blocks(size_t index, size_t removed, size_t added);
 
 #endif // DRAW_H
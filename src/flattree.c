@@ -0,0 +1,206 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "flattree.h"
+
+static void *grow_array(void *items, uint32_t *capacity, uint32_t needed, size_t itemSize) {
+    if(needed <= *capacity) return items;
+
+    uint32_t newCapacity = *capacity == 0 ? 64 : *capacity;
+    while(newCapacity < needed) newCapacity *= 2;
+
+    *capacity = newCapacity;
+    return realloc(items, (size_t)newCapacity * itemSize);
+}
+
+void flat_tree_init(MDFlatTree *tree, const char *source, size_t sourceSize) {
+    memset(tree, 0, sizeof(MDFlatTree));
+    tree->source = source;
+    tree->sourceSize = sourceSize;
+}
+
+void flat_tree_free(MDFlatTree *tree) {
+    free(tree->types);
+    free(tree->firstChild);
+    free(tree->nextSibling);
+    free(tree->payload);
+    free(tree->sourceStart);
+    free(tree->sourceEnd);
+    free(tree->headers);
+    free(tree->lists);
+    free(tree->texts);
+    free(tree->words);
+    free(tree->strings);
+    memset(tree, 0, sizeof(MDFlatTree));
+}
+
+static uint32_t push_node(MDFlatTree *tree, MDNodeType type) {
+    // all the node arrays have the same capacity
+    if(tree->count == tree->capacity) {
+        tree->capacity = tree->capacity == 0 ? 256 : tree->capacity * 2;
+
+        tree->types = realloc(tree->types, tree->capacity * sizeof(uint8_t));
+        tree->firstChild = realloc(tree->firstChild, tree->capacity * sizeof(uint32_t));
+        tree->nextSibling = realloc(tree->nextSibling, tree->capacity * sizeof(uint32_t));
+        tree->payload = realloc(tree->payload, tree->capacity * sizeof(uint32_t));
+        tree->sourceStart = realloc(tree->sourceStart, tree->capacity * sizeof(uint32_t));
+        tree->sourceEnd = realloc(tree->sourceEnd, tree->capacity * sizeof(uint32_t));
+    }
+
+    uint32_t index = tree->count++;
+    tree->types[index] = type;
+    tree->firstChild[index] = FLAT_TREE_NONE;
+    tree->nextSibling[index] = FLAT_TREE_NONE;
+    tree->payload[index] = FLAT_TREE_NONE;
+    tree->sourceStart[index] = UINT32_MAX;
+    tree->sourceEnd[index] = 0;
+    return index;
+}
+
+static uint32_t push_text(MDFlatTree *tree, uint32_t index, MDText *text) {
+    FlatText flatText = {
+        .size = text->size,
+        .firstWord = tree->wordCount,
+        .wordCount = text->wordCount,
+    };
+
+    if(text->data >= tree->source && text->data + text->size <= tree->source + tree->sourceSize) {
+        flatText.offset = text->data - tree->source;
+        tree->sourceStart[index] = flatText.offset;
+        tree->sourceEnd[index] = flatText.offset + text->size;
+    } else {
+        tree->strings = grow_array(tree->strings, &tree->stringsCapacity, tree->stringsSize + text->size, 1);
+        memcpy(tree->strings + tree->stringsSize, text->data, text->size);
+        flatText.offset = tree->sourceSize + tree->stringsSize;
+        tree->stringsSize += text->size;
+    }
+
+    tree->words = grow_array(tree->words, &tree->wordCapacity, tree->wordCount + text->wordCount, sizeof(MDWord));
+    memcpy(tree->words + tree->wordCount, text->words, text->wordCount * sizeof(MDWord));
+    tree->wordCount += text->wordCount;
+
+    tree->texts = grow_array(tree->texts, &tree->textCapacity, tree->textCount + 1, sizeof(FlatText));
+    tree->texts[tree->textCount] = flatText;
+    return tree->textCount++;
+}
+
+uint32_t flat_tree_open(MDFlatTree *tree, MDNode *node) {
+    uint32_t index = push_node(tree, node->type);
+
+    switch(node->type) {
+        case MD_HEADER_NODE:
+            tree->headers = grow_array(tree->headers, &tree->headerCapacity, tree->headerCount + 1, sizeof(MDHeaderNode));
+            tree->headers[tree->headerCount] = node->header;
+            tree->payload[index] = tree->headerCount++;
+            break;
+        case MD_LIST_NODE:
+            tree->lists = grow_array(tree->lists, &tree->listCapacity, tree->listCount + 1, sizeof(MDListNode));
+            tree->lists[tree->listCount] = node->list;
+            tree->payload[index] = tree->listCount++;
+            break;
+        case MD_TEXT_NODE:
+            tree->payload[index] = push_text(tree, index, &node->text);
+            break;
+        default: break;
+    }
+
+    if(tree->build.depth > 0) {
+        uint32_t level = tree->build.depth - 1;
+        uint32_t parent = tree->build.parents[level];
+        uint32_t lastChild = tree->build.lastChild[level];
+
+        if(lastChild == FLAT_TREE_NONE) {
+            tree->firstChild[parent] = index;
+        } else {
+            tree->nextSibling[lastChild] = index;
+        }
+
+        tree->build.lastChild[level] = index;
+    }
+
+    tree->build.parents[tree->build.depth] = index;
+    tree->build.lastChild[tree->build.depth] = FLAT_TREE_NONE;
+    tree->build.depth++;
+
+    return index;
+}
+
+void flat_tree_close(MDFlatTree *tree) {
+    if(tree->build.depth == 0) return;
+
+    tree->build.depth--;
+    uint32_t index = tree->build.parents[tree->build.depth];
+
+    // the range of the parent covers the ranges of its children
+    if(tree->build.depth > 0 && tree->sourceStart[index] <= tree->sourceEnd[index]) {
+        uint32_t parent = tree->build.parents[tree->build.depth - 1];
+
+        if(tree->sourceStart[index] < tree->sourceStart[parent]) {
+            tree->sourceStart[parent] = tree->sourceStart[index];
+        }
+
+        if(tree->sourceEnd[index] > tree->sourceEnd[parent]) {
+            tree->sourceEnd[parent] = tree->sourceEnd[index];
+        }
+    }
+}
+
+const char *flat_tree_text(MDFlatTree *tree, uint32_t node, size_t *size) {
+    FlatText *text = &tree->texts[tree->payload[node]];
+    *size = text->size;
+
+    if(text->offset >= tree->sourceSize) {
+        return tree->strings + (text->offset - tree->sourceSize);
+    }
+
+    return tree->source + text->offset;
+}
+
+void flat_tree_add_node(MDFlatTree *tree, MDNode *node) {
+    flat_tree_open(tree, node);
+
+    for(MDNode *child = node->children.head; child != NULL; child = child->next) {
+        flat_tree_add_node(tree, child);
+    }
+
+    flat_tree_close(tree);
+}
+
+MDNode *flat_tree_to_nodes(MDFlatTree *tree, Arena *arena) {
+    if(tree->count == 0) return NULL;
+
+    MDNode *nodes = arena_new_array(arena, MDNode, tree->count);
+
+    // the nodes are in pre-order, so the children of a node come after it
+    for(uint32_t i = 0; i < tree->count; i++) {
+        MDNode *node = &nodes[i];
+        node->type = tree->types[i];
+
+        switch(node->type) {
+            case MD_HEADER_NODE: node->header = tree->headers[tree->payload[i]]; break;
+            case MD_LIST_NODE: node->list = tree->lists[tree->payload[i]]; break;
+            case MD_TEXT_NODE: {
+                FlatText *text = &tree->texts[tree->payload[i]];
+                node->text.data = flat_tree_text(tree, i, &node->text.size);
+                node->text.words = tree->words + text->firstWord;
+                node->text.wordCount = text->wordCount;
+            } break;
+            default: break;
+        }
+
+        uint32_t child = tree->firstChild[i];
+        if(child != FLAT_TREE_NONE) node->children.head = &nodes[child];
+
+        while(child != FLAT_TREE_NONE) {
+            uint32_t next = tree->nextSibling[child];
+
+            node->children.tail = &nodes[child];
+            node->children.count++;
+            if(next != FLAT_TREE_NONE) nodes[child].next = &nodes[next];
+
+            child = next;
+        }
+    }
+
+    return &nodes[0];
+}
@@ -0,0 +1,74 @@
+#ifndef FLATTREE_H
+#define FLATTREE_H
+
+#include <stdint.h>
+
+#include "nodes.h"
+#include "utils.h"
+
+#define FLAT_TREE_NONE UINT32_MAX
+
+typedef struct {
+    uint32_t offset; // offset in the source, offsets past its end point into the strings of the tree
+    uint32_t size;
+    uint32_t firstWord; // index in the words of the tree
+    uint32_t wordCount;
+} FlatText;
+
+// Compact alternative to the MDNode tree: every field of the nodes is stored in its own
+// array, in pre-order, and the nodes are addressed by 32-bit indices. A traversal reads
+// the arrays linearly and the tree can be written to a file as it is.
+typedef struct {
+    uint8_t *types; // MDNodeType
+    uint32_t *firstChild;
+    uint32_t *nextSibling;
+    uint32_t *payload; // index in headers, lists or texts depending on the type
+    // part of the source covered by the text of the node, start > end if there's no text
+    uint32_t *sourceStart;
+    uint32_t *sourceEnd;
+    uint32_t count, capacity;
+
+    MDHeaderNode *headers;
+    uint32_t headerCount, headerCapacity;
+
+    MDListNode *lists;
+    uint32_t listCount, listCapacity;
+
+    FlatText *texts;
+    uint32_t textCount, textCapacity;
+
+    MDWord *words;
+    uint32_t wordCount, wordCapacity;
+
+    // text that md4c generates and isn't part of the source
+    char *strings;
+    uint32_t stringsSize, stringsCapacity;
+
+    const char *source;
+    uint32_t sourceSize;
+
+    // only used while the tree is being built
+    struct {
+        uint32_t parents[MAX_STACK_SIZE];
+        uint32_t lastChild[MAX_STACK_SIZE];
+        uint32_t depth;
+    } build;
+} MDFlatTree;
+
+void flat_tree_init(MDFlatTree *tree, const char *source, size_t sourceSize);
+void flat_tree_free(MDFlatTree *tree);
+
+// adds a copy of node as the last child of the open node and opens it,
+// the children of node are not copied
+uint32_t flat_tree_open(MDFlatTree *tree, MDNode *node);
+void flat_tree_close(MDFlatTree *tree);
+// adds a copy of node and all its descendants as the last child of the open node
+void flat_tree_add_node(MDFlatTree *tree, MDNode *node);
+
+// builds the MDNode tree in the arena and returns its root, the texts and the words
+// point into the tree, so its arrays have to outlive the nodes
+MDNode *flat_tree_to_nodes(MDFlatTree *tree, Arena *arena);
+
+const char *flat_tree_text(MDFlatTree *tree, uint32_t node, size_t *size);
+
+#endif // FLATTREE_H
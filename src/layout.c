@@ -0,0 +1,784 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "layout.h"
+#include "stats.h"
+#include "trace.h"
+
+#define DEFAULT_FONT_SIZE 20
+#define DEFAULT_PADDING_BETWEEN_BLOCKS 20
+
+// the first block starts here since every block adds the padding before its content
+#define LAYOUT_TOP (SCREEN_PADDING - DEFAULT_PADDING_BETWEEN_BLOCKS)
+// the blocks this far from the view are also laid out, so short scrolls find them ready
+#define LAYOUT_VIEW_MARGIN 1000
+// fewer blocks than this are laid out in the calling thread
+#define LAYOUT_PARALLEL_MIN_BLOCKS 16
+
+#define LIST_DOT_RADIUS 2
+#define LIST_LEFT_PADDING 20
+// padding between list items
+#define LIST_ITEM_PADDING 10
+#define LIST_PADDING_AFTER_MARK 10
+
+#define TEXT_SPACING 2
+
+const int HEADER_FONT_SIZES[] = {
+    DEFAULT_FONT_SIZE * 2, // level 1
+    DEFAULT_FONT_SIZE * 1.75, // level 2
+    DEFAULT_FONT_SIZE * 1.5, // level 3
+    DEFAULT_FONT_SIZE * 1.25, // level 4
+    DEFAULT_FONT_SIZE * 1, // level 5
+    DEFAULT_FONT_SIZE * 0.8, // level 6
+};
+
+// the shape of a block is a list of operations on the position where the next item
+// goes, flowing the shape runs them for a width
+typedef enum {
+    LAYOUT_OP_START, // a block starts: x = left, y += prevHeight + value
+    LAYOUT_OP_NEWLINE, // x = left, y += value
+    LAYOUT_OP_ADVANCE, // x += value
+    LAYOUT_OP_END, // a block ends: prevHeight = value
+    LAYOUT_OP_WORD, // the word goes to the next line if it doesn't fit
+    LAYOUT_OP_CIRCLE,
+} LayoutOpType;
+
+typedef struct {
+    LayoutOpType type;
+    float value; // for words it's their width, for circles the radius
+
+    // paddings of the line, words wrap at the left one
+    float left;
+    float right;
+
+    int fontSize; // height of the line for words and circles
+    FontWeight weight;
+    Color color;
+    const char *str;
+    size_t size;
+} LayoutOp;
+
+struct LayoutShape {
+    LayoutOp *ops;
+    size_t count, capacity;
+
+    LayoutFlow flows[LAYOUT_FLOW_CACHE];
+};
+
+typedef struct {
+    // the blocks can be shaped in any thread, so they use the fonts and the
+    // arena of that thread
+    LayoutFonts *fonts;
+    Arena *arena;
+    LayoutShape *shape; // shape where the operations are being added
+    // for the statistics
+    size_t wordCount; // words measured
+    size_t nodeCount; // nodes visited
+} LayoutCtx;
+
+typedef struct {
+    int fontSize;
+
+    // this padding will be used to separate the content from the borders of the screen
+    struct {
+        int left;
+        int right;
+    } padding;
+
+    int paddingBetweenBlocks;
+
+    FontWeight weight;
+} LayoutStyle;
+
+static void layout_node(LayoutCtx *ctx, MDNode *node, LayoutStyle style);
+
+static LayoutOp *push_op(LayoutShape *shape, LayoutOpType type, float value) {
+    if(shape->count >= shape->capacity) {
+        shape->capacity = shape->capacity == 0 ? 64 : shape->capacity * 2;
+        shape->ops = realloc(shape->ops, shape->capacity * sizeof(LayoutOp));
+    }
+
+    LayoutOp *op = &shape->ops[shape->count++];
+    memset(op, 0, sizeof(LayoutOp));
+    op->type = type;
+    op->value = value;
+    return op;
+}
+
+static void layout_node_children(LayoutCtx *ctx, MDNodeList children, LayoutStyle style) {
+    MDNode *child = children.head;
+    while(child != NULL) {
+        layout_node(ctx, child, style);
+        child = child->next;
+    }
+}
+
+static void layout_word(LayoutCtx *ctx, const char *word, size_t size, LayoutStyle style, Color color) {
+    LayoutFonts *fonts = ctx->fonts;
+    MeasureCache *cache = style.weight == FONT_WEIGHT_NORMAL ? &fonts->normalCache : &fonts->boldCache;
+
+    // the measure is kept in the shape, so flowing the block again doesn't measure it
+    float width = measure_text(cache, word, size, style.fontSize, TEXT_SPACING);
+    ctx->wordCount++;
+
+    LayoutOp *op = push_op(ctx->shape, LAYOUT_OP_WORD, width);
+    op->left = style.padding.left;
+    op->right = style.padding.right;
+    op->fontSize = style.fontSize;
+    op->weight = style.weight;
+    op->color = color;
+    op->str = word;
+    op->size = size;
+}
+
+static void layout_text_node(LayoutCtx *ctx, MDNode *textNode, LayoutStyle style) {
+    Color color = WHITE;
+    MDText *text = &textNode->text;
+
+    for(size_t i = 0; i < text->wordCount; i++) {
+        MDWord word = text->words[i];
+        layout_word(ctx, text->data + word.offset, word.length, style, color);
+    }
+}
+
+static void layout_list_node(LayoutCtx *ctx, MDNode *listNode, LayoutStyle style) {
+    style.padding.left += LIST_LEFT_PADDING;
+
+    push_op(ctx->shape, LAYOUT_OP_START, style.paddingBetweenBlocks)->left = style.padding.left;
+
+    MDNode *listItem = listNode->children.head;
+
+    size_t i = 0;
+
+    while(listItem != NULL) {
+        if(i > 0) {
+            push_op(ctx->shape, LAYOUT_OP_NEWLINE, style.fontSize + LIST_ITEM_PADDING)->left = style.padding.left;
+        }
+
+        if(listNode->list.ordered) {
+            char *listMark = arena_alloc_uninit(ctx->arena, 20, 1);
+            int size = snprintf(listMark, 20, "%lu.", i + listNode->list.startIndex);
+            layout_word(ctx, listMark, size, style, WHITE);
+        } else {
+            LayoutOp *op = push_op(ctx->shape, LAYOUT_OP_CIRCLE, LIST_DOT_RADIUS);
+            op->fontSize = style.fontSize;
+            op->color = WHITE;
+        }
+        push_op(ctx->shape, LAYOUT_OP_ADVANCE, LIST_PADDING_AFTER_MARK);
+
+        LayoutStyle localStyle = style;
+        localStyle.padding.left += LIST_PADDING_AFTER_MARK;
+        localStyle.paddingBetweenBlocks = LIST_ITEM_PADDING;
+
+        layout_node_children(ctx, listItem->children, localStyle);
+
+        listItem = listItem->next;
+        i++;
+    }
+
+    push_op(ctx->shape, LAYOUT_OP_END, style.fontSize);
+}
+
+static void layout_node(LayoutCtx *ctx, MDNode *node, LayoutStyle style) {
+    ctx->nodeCount++;
+
+    switch(node->type) {
+        case MD_DOCUMENT_NODE:
+            layout_node_children(ctx, node->children, style);
+            break;
+        case MD_HEADER_NODE:
+            push_op(ctx->shape, LAYOUT_OP_START, style.paddingBetweenBlocks)->left = style.padding.left;
+
+            style.fontSize = HEADER_FONT_SIZES[node->header.level - 1];
+            layout_node_children(ctx, node->children, style);
+            push_op(ctx->shape, LAYOUT_OP_END, style.fontSize);
+            break;
+        case MD_TEXT_NODE:
+            layout_text_node(ctx, node, style);
+            break;
+        case MD_P_NODE:
+            push_op(ctx->shape, LAYOUT_OP_START, style.paddingBetweenBlocks)->left = style.padding.left;
+            layout_node_children(ctx, node->children, style);
+            push_op(ctx->shape, LAYOUT_OP_END, style.fontSize);
+            break;
+        case MD_LIST_NODE: layout_list_node(ctx, node, style); break;
+        // ignore it since it will be handled by MD_LIST_NODE case
+        case MD_LIST_ITEM_NODE: break;
+        case MD_BOLD_NODE:
+            style.weight = FONT_WEIGHT_BOLD;
+            layout_node_children(ctx, node->children, style);
+            break;
+    }
+}
+
+static LayoutItem *push_item(LayoutFlow *flow, LayoutItemType type, Vector2 pos, float height) {
+    if(flow->count >= flow->capacity) {
+        flow->capacity = flow->capacity == 0 ? 64 : flow->capacity * 2;
+        flow->items = realloc(flow->items, flow->capacity * sizeof(LayoutItem));
+    }
+
+    LayoutItem *item = &flow->items[flow->count++];
+    memset(item, 0, sizeof(LayoutItem));
+    item->type = type;
+    item->pos = pos;
+    item->height = height;
+
+    if(height > flow->maxItemHeight) flow->maxItemHeight = height;
+
+    return item;
+}
+
+// breaks the lines of the shape for the width of the flow
+static void flow_shape(LayoutShape *shape, LayoutFlow *flow) {
+    flow->count = 0;
+    flow->maxItemHeight = 0;
+
+    // the block starts at the bottom of the previous one, every node adds the
+    // padding between blocks before its content
+    Vector2 pos = { SCREEN_PADDING, 0 };
+    float prevHeight = 0;
+
+    for(size_t i = 0; i < shape->count; i++) {
+        LayoutOp *op = &shape->ops[i];
+
+        switch(op->type) {
+            case LAYOUT_OP_START:
+                pos.x = op->left;
+                pos.y += prevHeight + op->value;
+                break;
+            case LAYOUT_OP_NEWLINE:
+                pos.x = op->left;
+                pos.y += op->value;
+                break;
+            case LAYOUT_OP_ADVANCE:
+                pos.x += op->value;
+                break;
+            case LAYOUT_OP_END:
+                prevHeight = op->value;
+                break;
+            case LAYOUT_OP_WORD: {
+                if(pos.x + op->value > flow->width - (op->left + op->right)) {
+                    pos.x = op->left;
+                    pos.y += op->fontSize;
+                }
+
+                LayoutItem *item = push_item(flow, LAYOUT_ITEM_TEXT, pos, op->fontSize);
+                item->color = op->color;
+                item->text.str = op->str;
+                item->text.size = op->size;
+                item->text.fontSize = op->fontSize;
+                item->text.weight = op->weight;
+
+                pos.x += op->value;
+            } break;
+            case LAYOUT_OP_CIRCLE: {
+                LayoutItem *item = push_item(flow, LAYOUT_ITEM_CIRCLE, pos, op->fontSize);
+                item->color = op->color;
+                item->radius = op->value;
+            } break;
+        }
+    }
+
+    flow->height = pos.y + prevHeight;
+}
+
+static LayoutShape *shape_block(MDNode *node, LayoutFonts *fonts, Arena *arena) {
+    int64_t start = stats_now();
+    LayoutShape *shape = calloc(1, sizeof(LayoutShape));
+
+    LayoutStyle style = {
+        .fontSize = DEFAULT_FONT_SIZE,
+        .padding = {
+            .left = SCREEN_PADDING,
+            .right = SCREEN_PADDING,
+        },
+        .paddingBetweenBlocks = DEFAULT_PADDING_BETWEEN_BLOCKS,
+        .weight = FONT_WEIGHT_NORMAL,
+    };
+
+    LayoutCtx ctx = {
+        .fonts = fonts,
+        .arena = arena,
+        .shape = shape,
+    };
+
+    layout_node(&ctx, node, style);
+
+    stats_add_time(STATS_MEASURE, stats_now() - start);
+    stats_add(STATS_WORDS_MEASURED, ctx.wordCount);
+    stats_add(STATS_NODES_VISITED, ctx.nodeCount);
+    return shape;
+}
+
+static LayoutFlow *find_flow(Layout *layout, LayoutShape *shape) {
+    for(size_t i = 0; i < LAYOUT_FLOW_CACHE; i++) {
+        LayoutFlow *flow = &shape->flows[i];
+
+        if(flow->width == layout->width) {
+            flow->lastUsed = ++layout->flowClock;
+            return flow;
+        }
+    }
+
+    return NULL;
+}
+
+// shapes the block if it wasn't shaped yet and flows it for the width of the layout,
+// replacing the flow of the least recently used width
+// it only touches the block, so different blocks can be laid out in parallel
+static void layout_block(Layout *layout, LayoutBlock *block, LayoutFonts *fonts, Arena *arena) {
+    if(block->shape == NULL) block->shape = shape_block(block->node, fonts, arena);
+    LayoutShape *shape = block->shape;
+
+    LayoutFlow *flow = &shape->flows[0];
+    for(size_t i = 1; i < LAYOUT_FLOW_CACHE; i++) {
+        if(shape->flows[i].lastUsed < flow->lastUsed) flow = &shape->flows[i];
+    }
+
+    flow->width = layout->width;
+    flow_shape(shape, flow);
+    block->flow = flow;
+}
+
+typedef struct {
+    Layout *layout;
+    size_t *indices; // blocks to lay out
+} LayoutJob;
+
+static void layout_block_task(void *data, size_t index, size_t worker) {
+    LayoutJob *job = data;
+    Layout *layout = job->layout;
+    LayoutBlock *block = &layout->blocks[job->indices[index]];
+    int64_t start = stats_now();
+
+    // the worker 0 is the thread that called layout_prepare
+    if(worker == 0) {
+        layout_block(layout, block, layout->fonts, layout->arena);
+    } else {
+        layout_block(layout, block, &layout->workers[worker].fonts, layout->workers[worker].arena);
+    }
+
+    trace_event_arg("layout", "layout block", start, "block", job->indices[index]);
+}
+
+static void free_workers(Layout *layout) {
+    if(layout->workers == NULL) return;
+
+    for(size_t i = 1; i < layout->pool->threadCount; i++) {
+        LayoutWorker *worker = &layout->workers[i];
+        measure_cache_free(&worker->fonts.normalCache);
+        measure_cache_free(&worker->fonts.boldCache);
+        arena_free(worker->arena);
+    }
+
+    free(layout->workers);
+    layout->workers = NULL;
+}
+
+// the blocks are independent, so when there are many of them they are laid out in
+// block-local coordinates by a thread pool and their y comes from the Fenwick tree
+static void layout_blocks(Layout *layout, size_t *indices, size_t count) {
+    LayoutJob job = {
+        .layout = layout,
+        .indices = indices,
+    };
+
+    if(count < LAYOUT_PARALLEL_MIN_BLOCKS) {
+        for(size_t i = 0; i < count; i++) layout_block_task(&job, i, 0);
+        return;
+    }
+
+    if(layout->pool == NULL) {
+        layout->pool = malloc(sizeof(ThreadPool));
+        thread_pool_init(layout->pool, 0);
+    }
+
+    if(layout->workers == NULL) {
+        // the measure caches aren't thread-safe, so every thread has its own
+        layout->workers = calloc(layout->pool->threadCount, sizeof(LayoutWorker));
+
+        for(size_t i = 1; i < layout->pool->threadCount; i++) {
+            LayoutWorker *worker = &layout->workers[i];
+            worker->fonts.normal = layout->fonts->normal;
+            worker->fonts.bold = layout->fonts->bold;
+            measure_cache_init(&worker->fonts.normalCache, worker->fonts.normal);
+            measure_cache_init(&worker->fonts.boldCache, worker->fonts.bold);
+            worker->arena = arena_create();
+        }
+    }
+
+    thread_pool_run(layout->pool, layout_block_task, &job, count);
+}
+
+static void free_block(LayoutBlock *block) {
+    LayoutShape *shape = block->shape;
+    if(shape == NULL) return;
+
+    for(size_t i = 0; i < LAYOUT_FLOW_CACHE; i++) {
+        free(shape->flows[i].items);
+    }
+    free(shape->ops);
+    free(shape);
+}
+
+// the heights of the blocks are kept in a Fenwick tree, so the position of a block
+// and the block at a position are found in O(log n) even after a height changes
+static void tree_add(Layout *layout, size_t index, double delta) {
+    for(size_t i = index + 1; i <= layout->count; i += i & -i) {
+        layout->tree[i] += delta;
+    }
+}
+
+// sum of the heights of the blocks before index
+static double tree_prefix(Layout *layout, size_t index) {
+    double sum = 0;
+    for(size_t i = index; i > 0; i -= i & -i) {
+        sum += layout->tree[i];
+    }
+    return sum;
+}
+
+static void tree_build(Layout *layout) {
+    for(size_t i = 1; i <= layout->count; i++) {
+        layout->tree[i] = layout->blocks[i - 1].height;
+    }
+
+    for(size_t i = 1; i <= layout->count; i++) {
+        size_t parent = i + (i & -i);
+        if(parent <= layout->count) layout->tree[parent] += layout->tree[i];
+    }
+}
+
+// adds the last block of the layout to the tree
+static void tree_push(Layout *layout) {
+    size_t i = layout->count;
+    layout->tree[i] = layout->blocks[i - 1].height
+        + tree_prefix(layout, i - 1) - tree_prefix(layout, i - (i & -i));
+}
+
+static void update_height(Layout *layout) {
+    layout->height = LAYOUT_TOP + tree_prefix(layout, layout->count);
+}
+
+static void reserve_blocks(Layout *layout, size_t count) {
+    if(count <= layout->capacity) return;
+
+    layout->capacity = layout->capacity == 0 ? 64 : layout->capacity * 2;
+    if(layout->capacity < count) layout->capacity = count;
+
+    layout->blocks = realloc(layout->blocks, layout->capacity * sizeof(LayoutBlock));
+    layout->tree = realloc(layout->tree, (layout->capacity + 1) * sizeof(double));
+}
+
+static LayoutBlock *push_block(Layout *layout, MDNode *node) {
+    reserve_blocks(layout, layout->count + 1);
+
+    LayoutBlock *block = &layout->blocks[layout->count++];
+    memset(block, 0, sizeof(LayoutBlock));
+    block->node = node;
+    return block;
+}
+
+// number of bytes of text inside the node, nodeCount gets the nodes that were visited
+static size_t node_text_size(MDNode *node, size_t *nodeCount) {
+    (*nodeCount)++;
+    if(node->type == MD_TEXT_NODE) return node->text.size;
+
+    size_t size = 0;
+    for(MDNode *child = node->children.head; child != NULL; child = child->next) {
+        size += node_text_size(child, nodeCount);
+    }
+    return size;
+}
+
+static float char_width(Layout *layout, int fontSize) {
+    // the font is monospaced, so every character has the same width
+    return measure_text(&layout->fonts->normalCache, "0", 1, fontSize, TEXT_SPACING) + TEXT_SPACING;
+}
+
+// a block that wasn't laid out is estimated once, then its height for a width is only
+// some arithmetic, so a resize doesn't need to walk the nodes again
+static void estimate_block(Layout *layout, MDNode *node, LayoutEstimate *estimate) {
+    estimate->fixedHeight = DEFAULT_PADDING_BETWEEN_BLOCKS;
+    estimate->fontSize = DEFAULT_FONT_SIZE;
+    estimate->indent = 0;
+    estimate->minLines = 1;
+
+    switch(node->type) {
+        case MD_HEADER_NODE:
+            estimate->fontSize = HEADER_FONT_SIZES[node->header.level - 1];
+            break;
+        case MD_LIST_NODE:
+            estimate->indent = LIST_LEFT_PADDING + LIST_PADDING_AFTER_MARK * 2;
+            estimate->minLines = node->children.count > 0 ? node->children.count : 1;
+            estimate->fixedHeight += (estimate->minLines - 1) * LIST_ITEM_PADDING;
+            break;
+        default: break;
+    }
+
+    size_t nodeCount = 0;
+    estimate->textWidth = node_text_size(node, &nodeCount) * char_width(layout, estimate->fontSize);
+    stats_add(STATS_NODES_VISITED, nodeCount);
+}
+
+// height of a block before it's laid out, it's only used to place the blocks
+// that aren't visible yet
+static float estimated_height(Layout *layout, LayoutEstimate *estimate) {
+    // the same space that the words leave at the right
+    float lineWidth = layout->width - 3 * SCREEN_PADDING - 2 * estimate->indent;
+    if(lineWidth < 1) lineWidth = 1;
+
+    float lines = ceilf(estimate->textWidth / lineWidth);
+    if(lines < estimate->minLines) lines = estimate->minLines;
+
+    return estimate->fixedHeight + lines * estimate->fontSize;
+}
+
+// the block doesn't have a flow for the current width, so its height is the one of a
+// flow that was cached for this width or an estimation
+static void reset_block_height(Layout *layout, LayoutBlock *block) {
+    block->flow = block->shape != NULL ? find_flow(layout, block->shape) : NULL;
+
+    block->height = block->flow != NULL
+        ? block->flow->height
+        : estimated_height(layout, &block->estimate);
+}
+
+static void mark_changed(Layout *layout, float y) {
+    if(y < layout->changedY) layout->changedY = y;
+}
+
+static void layout_clear(Layout *layout) {
+    for(size_t i = 0; i < layout->count; i++) {
+        free_block(&layout->blocks[i]);
+    }
+    layout->count = 0;
+    layout->height = LAYOUT_TOP;
+    layout->changedY = 0;
+
+    // the fonts can be different now
+    free_workers(layout);
+
+    if(layout->arena != NULL) arena_free(layout->arena);
+    layout->arena = arena_create();
+}
+
+void layout_update(Layout *layout, MDNode *docNode, LayoutFonts *fonts, int width) {
+    bool valid = layout->arena != NULL
+        && layout->docNode == docNode
+        && layout->fonts == fonts;
+
+    MDNode *child = docNode->children.head;
+
+    if(!valid) {
+        layout_clear(layout);
+        layout->docNode = docNode;
+        layout->fonts = fonts;
+        layout->width = width;
+    } else {
+        if(layout->width != width) {
+            // the shapes don't depend on the width, so the blocks are only flowed
+            // again when they are visible
+            layout->width = width;
+
+            for(size_t i = 0; i < layout->count; i++) {
+                reset_block_height(layout, &layout->blocks[i]);
+            }
+
+            tree_build(layout);
+            update_height(layout);
+            layout->changedY = 0;
+        }
+
+        // the document can still be growing (e.g. while it's being parsed), so only
+        // the blocks added after the last one are added
+        if(layout->count > 0) child = layout->blocks[layout->count - 1].node->next;
+    }
+
+    if(child == NULL) return;
+
+    mark_changed(layout, layout->height);
+
+    // the blocks are only estimated here, layout_prepare lays out the visible ones
+    while(child != NULL) {
+        LayoutBlock *block = push_block(layout, child);
+        estimate_block(layout, child, &block->estimate);
+        block->height = estimated_height(layout, &block->estimate);
+        tree_push(layout);
+
+        child = child->next;
+    }
+
+    update_height(layout);
+}
+
+float layout_prepare(Layout *layout, float top, float bottom) {
+    float shift = 0;
+
+    size_t *pending = NULL;
+    size_t capacity = 0;
+
+    // the view moves with the blocks before it, and the new heights can show
+    // blocks that weren't visible before, so it's repeated until nothing changes
+    while(true) {
+        size_t count = 0;
+
+        size_t i = layout_find_block(layout, top - LAYOUT_VIEW_MARGIN);
+        float y = layout_block_y(layout, i);
+
+        for(; i < layout->count && y <= bottom + LAYOUT_VIEW_MARGIN; i++) {
+            if(layout->blocks[i].flow == NULL) {
+                if(count == capacity) {
+                    capacity = capacity == 0 ? 64 : capacity * 2;
+                    pending = realloc(pending, capacity * sizeof(size_t));
+                }
+                pending[count++] = i;
+            }
+
+            y += layout->blocks[i].height;
+        }
+
+        if(count == 0) break;
+
+        layout_blocks(layout, pending, count);
+
+        // the estimated heights are replaced in order, so the position of every
+        // block already has the corrections of the blocks before it
+        for(size_t j = 0; j < count; j++) {
+            LayoutBlock *block = &layout->blocks[pending[j]];
+            block->flow->lastUsed = ++layout->flowClock;
+
+            float blockY = layout_block_y(layout, pending[j]);
+            float estimated = block->height;
+            block->height = block->flow->height;
+
+            float delta = block->height - estimated;
+            if(delta == 0) continue;
+
+            tree_add(layout, pending[j], delta);
+            mark_changed(layout, blockY);
+
+            if(blockY + estimated <= top) {
+                shift += delta;
+                top += delta;
+                bottom += delta;
+            }
+        }
+    }
+
+    free(pending);
+
+    update_height(layout);
+    return shift;
+}
+
+void layout_splice(Layout *layout, size_t index, size_t removed, size_t added) {
+    if(layout->arena == NULL || index > layout->count) return;
+
+    if(index + removed > layout->count) {
+        // the replaced blocks weren't added yet, so layout_update will add
+        // everything after index
+        for(size_t i = index; i < layout->count; i++) {
+            free_block(&layout->blocks[i]);
+        }
+
+        layout->count = index;
+        update_height(layout);
+        mark_changed(layout, layout->height);
+        return;
+    }
+
+    for(size_t i = index; i < index + removed; i++) {
+        free_block(&layout->blocks[i]);
+    }
+
+    size_t count = layout->count - removed + added;
+    reserve_blocks(layout, count);
+
+    memmove(
+        &layout->blocks[index + added],
+        &layout->blocks[index + removed],
+        (layout->count - index - removed) * sizeof(LayoutBlock)
+    );
+    layout->count = count;
+
+    MDNode *node = index == 0
+        ? layout->docNode->children.head
+        : layout->blocks[index - 1].node->next;
+
+    for(size_t i = index; i < index + added; i++) {
+        LayoutBlock *block = &layout->blocks[i];
+        memset(block, 0, sizeof(LayoutBlock));
+        block->node = node;
+        estimate_block(layout, node, &block->estimate);
+        block->height = estimated_height(layout, &block->estimate);
+
+        node = node->next;
+    }
+
+    // the blocks don't depend on each other, so the ones after the change only move
+    tree_build(layout);
+    update_height(layout);
+    mark_changed(layout, layout_block_y(layout, index));
+}
+
+float layout_block_y(Layout *layout, size_t index) {
+    return LAYOUT_TOP + tree_prefix(layout, index);
+}
+
+size_t layout_find_block(Layout *layout, float y) {
+    double rest = y - LAYOUT_TOP;
+    if(rest < 0) return 0;
+
+    size_t step = 1;
+    while(step * 2 <= layout->count) step *= 2;
+
+    // walks down the tree looking for the last block that starts at or before y
+    size_t index = 0;
+    for(; step > 0; step /= 2) {
+        if(index + step <= layout->count && layout->tree[index + step] <= rest) {
+            index += step;
+            rest -= layout->tree[index];
+        }
+    }
+
+    return index;
+}
+
+size_t layout_find_item(LayoutFlow *flow, float y) {
+    // the items are sorted by their top, so an item that starts before
+    // y - maxItemHeight can't reach y
+    float top = y - flow->maxItemHeight;
+    size_t low = 0, high = flow->count;
+
+    while(low < high) {
+        size_t mid = low + (high - low) / 2;
+
+        if(flow->items[mid].pos.y < top) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+void layout_free(Layout *layout) {
+    for(size_t i = 0; i < layout->count; i++) {
+        free_block(&layout->blocks[i]);
+    }
+    free(layout->blocks);
+    free(layout->tree);
+
+    free_workers(layout);
+    if(layout->pool != NULL) {
+        thread_pool_free(layout->pool);
+        free(layout->pool);
+    }
+
+    if(layout->arena != NULL) arena_free(layout->arena);
+    memset(layout, 0, sizeof(Layout));
+}
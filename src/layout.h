@@ -0,0 +1,141 @@
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include "measure.h"
+#include "nodes.h"
+#include "raylib.h"
+#include "utils.h"
+
+#define SCREEN_PADDING 20 // separation between the content and the screen
+
+typedef enum {
+    FONT_WEIGHT_NORMAL,
+    FONT_WEIGHT_BOLD,
+} FontWeight;
+
+typedef struct {
+    Font normal;
+    Font bold;
+
+    // the words are measured through these instead of MeasureTextEx
+    MeasureCache normalCache;
+    MeasureCache boldCache;
+} LayoutFonts;
+
+typedef enum {
+    LAYOUT_ITEM_TEXT,
+    LAYOUT_ITEM_CIRCLE,
+} LayoutItemType;
+
+// something already positioned that the draw stage only has to replay
+// pos is the top left corner of the item relative to the top of its block, the items
+// of a block are sorted by pos.y so the visible ones can be found with a binary search
+typedef struct {
+    LayoutItemType type;
+    Vector2 pos;
+    float height; // height of the line where the item is
+    Color color;
+
+    union {
+        struct {
+            // slice of a text node, or of the layout arena for generated text like list marks
+            const char *str;
+            size_t size;
+            int fontSize;
+            FontWeight weight;
+        } text;
+        float radius; // circles are vertically centered in their line
+    };
+} LayoutItem;
+
+// the items of a block for one width
+typedef struct {
+    int width; // 0 if it isn't used
+    uint64_t lastUsed;
+
+    float height;
+    float maxItemHeight;
+
+    LayoutItem *items;
+    size_t count, capacity;
+} LayoutFlow;
+
+// the flows of the last widths are kept, so going back to a width doesn't need to
+// break the lines again
+#define LAYOUT_FLOW_CACHE 4
+
+// what a block needs to estimate its height at any width
+typedef struct {
+    float fixedHeight; // paddings that don't depend on the width
+    float textWidth; // width of the text if it was in one line
+    float indent;
+    int fontSize;
+    int minLines;
+} LayoutEstimate;
+
+typedef struct LayoutShape LayoutShape;
+
+// every top-level child of the document is laid out on its own, starting from the
+// bottom of the previous block, so a block doesn't depend on what is before it
+// The layout of a block is done in two steps: the shape measures the words and keeps
+// the structure of the block, it doesn't depend on the width. The flow breaks the
+// lines of the shape for a width, so a resize only has to flow the blocks again.
+// the blocks far from the view aren't laid out, they only have an estimated height
+typedef struct {
+    MDNode *node;
+    float height; // height of the flow, or the estimated one if flow is NULL
+    LayoutEstimate estimate;
+
+    LayoutShape *shape; // NULL until the block is visible for the first time
+    LayoutFlow *flow; // flow of the shape for the width of the layout
+} LayoutBlock;
+
+// what a thread of the pool needs to shape blocks
+typedef struct {
+    LayoutFonts fonts; // same fonts as the layout with caches only used by this thread
+    Arena *arena;
+} LayoutWorker;
+
+typedef struct {
+    // the layout is only valid for this (document, width, fonts)
+    MDNode *docNode;
+    int width;
+    LayoutFonts *fonts;
+
+    LayoutBlock *blocks;
+    size_t count, capacity;
+    double *tree; // Fenwick tree of the heights of the blocks, indexed from 1
+
+    Arena *arena; // memory for the generated text of the items
+    float height;
+    uint64_t flowClock; // used to find the least recently used flows
+
+    // created the first time there are enough blocks to lay out in parallel
+    ThreadPool *pool;
+    LayoutWorker *workers; // one per thread of the pool, the first one isn't used
+
+    // everything below this y may have changed since whoever caches the drawn
+    // layout last looked at it, they set it back to FLT_MAX
+    float changedY;
+} Layout;
+
+// starts the layout again only if the document or the fonts changed, a new width keeps
+// the shapes and only drops the flows, otherwise only the top-level blocks added since the last call are added
+// the blocks only get an estimated height, layout_prepare lays them out
+void layout_update(Layout *layout, MDNode *docNode, LayoutFonts *fonts, int width);
+// lays out the blocks around [top, bottom) that don't have a flow for the current width
+// returns how much the blocks before top moved, so the view can move with them
+float layout_prepare(Layout *layout, float top, float bottom);
+void layout_free(Layout *layout);
+// the top-level blocks [index, index + removed) of the document were replaced by added
+// new ones, the new blocks are estimated and the ones after them are moved
+void layout_splice(Layout *layout, size_t index, size_t removed, size_t added);
+
+// absolute position of the top of the block
+float layout_block_y(Layout *layout, size_t index);
+// index of the first block that ends after y, or layout->count if there's none
+size_t layout_find_block(Layout *layout, float y);
+// index of the first item of the flow that could be visible at y (relative to the block)
+size_t layout_find_item(LayoutFlow *flow, float y);
+
+#endif // LAYOUT_H
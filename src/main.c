@@ -1,11 +1,29 @@
+#include <float.h>
+#include <limits.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "raylib.h"
 #include "utils.h"
+#include "cache.h"
+#include "document.h"
 #include "draw.h"
+#include "flattree.h"
 #include "nodes.h"
+#include "overlay.h"
 #include "parser.h"
+#include "redraw.h"
+#include "scroll.h"
+#include "stats.h"
+#include "trace.h"
+#include "watch.h"
+
+#define RENDER_STRIP_HEIGHT 256
+// the whole image is in memory, so long documents are cropped
+#define RENDER_MAX_HEIGHT 32768
 
 void print_indent(int indent) {
     for(int i = 0; i < indent; i++) {
@@ -13,53 +31,71 @@ void print_indent(int indent) {
     }
 }
 
-void print_md_node(MDNode *node, int indent);
+void print_md_node(MDFlatTree *tree, uint32_t node, int indent);
 
-void print_md_node_children(MDNodeList children, int indent) {
-    MDNode *node = children.head;
-    while(node != NULL) {
-        print_md_node(node, indent);
-        node = node->next;
+void print_md_node_children(MDFlatTree *tree, uint32_t node, int indent) {
+    uint32_t child = tree->firstChild[node];
+    while(child != FLAT_TREE_NONE) {
+        print_md_node(tree, child, indent);
+        child = tree->nextSibling[child];
     }
 }
 
-void print_md_node(MDNode *node, int indent) {
+void print_md_node(MDFlatTree *tree, uint32_t node, int indent) {
     print_indent(indent);
-    switch(node->type) {
+    switch(tree->types[node]) {
         case MD_DOCUMENT_NODE:
             printf("DOCUMENT {\n");
-            print_md_node_children(node->children, indent + 4);
+            print_md_node_children(tree, node, indent + 4);
             printf("}\n");
             break;
         case MD_HEADER_NODE:
-            printf("HEADER(%u) {\n", node->header.level);
-            print_md_node_children(node->children, indent + 4);
+            printf("HEADER(%u) {\n", tree->headers[tree->payload[node]].level);
+            print_md_node_children(tree, node, indent + 4);
             print_indent(indent);
             printf("}\n");
             break;
-        case MD_TEXT_NODE:
-            printf("TEXT(%s)\n", node->text);
-            break;
+        case MD_TEXT_NODE: {
+            size_t size;
+            const char *text = flat_tree_text(tree, node, &size);
+            printf("TEXT(%.*s)\n", (int)size, text);
+        } break;
         case MD_P_NODE:
-            printf("PARAGRAPH {");
-            print_md_node_children(node->children, indent + 4);
+            printf("PARAGRAPH {\n");
+            print_md_node_children(tree, node, indent + 4);
+            print_indent(indent);
+            printf("}\n");
+            break;
+        case MD_LIST_NODE: {
+            MDListNode list = tree->lists[tree->payload[node]];
+            printf("LIST(%s, %u) {\n", list.ordered ? "ordered" : "unordered", list.startIndex);
+            print_md_node_children(tree, node, indent + 4);
+            print_indent(indent);
+            printf("}\n");
+        } break;
+        case MD_LIST_ITEM_NODE:
+            printf("LIST_ITEM {\n");
+            print_md_node_children(tree, node, indent + 4);
+            print_indent(indent);
+            printf("}\n");
+            break;
+        case MD_BOLD_NODE:
+            printf("BOLD {\n");
+            print_md_node_children(tree, node, indent + 4);
             print_indent(indent);
             printf("}\n");
             break;
         default:
-            TraceLog(LOG_ERROR, "Node (%d) not implemented yet", node->type);
+            TraceLog(LOG_ERROR, "Node (%d) not implemented yet", tree->types[node]);
     }
 }
 
-int main(int argc, const char **args) {
-    if(argc != 2) {
-        printf("Usage: ./main <file-path>\n");
-        return 1;
-    }
-
-    const char *filePath = args[1];
+// prints the tree of the document instead of opening the window
+static int dump_file(const char *filePath) {
+    MDFlatTree tree;
     ParserData data = {
         .arena = arena_create(),
+        .flatTree = &tree,
     };
 
     parse_file(filePath, &data);
@@ -68,43 +104,316 @@ int main(int argc, const char **args) {
         return 1;
     }
 
+    print_md_node(&tree, 0, 0);
+
+    flat_tree_free(&tree);
+    arena_free(data.arena);
+    source_file_close(&data.source);
+    return 0;
+}
+
+typedef struct {
+    const char *filePath;
+    bool watch;
+    bool check; // in watch mode every reload is compared with a full parse (see document.h)
+    bool dump;
+    bool continuous; // draw every frame instead of only when something changed
+    bool noCache; // always parse the file, and don't save it in the cache
+    bool profile; // start with the profiler overlay, it's toggled with OVERLAY_TOGGLE_KEY
+    const char *tracePath; // records the trace events in this file (see trace.h)
+
+    // draws the document into this image instead of opening the window
+    const char *renderPath;
+    int renderWidth;
+    int renderHeight; // 0 to draw the whole document, up to RENDER_MAX_HEIGHT
+} Options;
+
+static bool parse_int_arg(int argc, const char **args, int *i, int *value) {
+    if(*i + 1 >= argc) return false;
+
+    char *end;
+    long number = strtol(args[++*i], &end, 10);
+    if(*end != '\0' || number <= 0 || number > 1 << 16) return false;
+
+    *value = number;
+    return true;
+}
+
+// the path after the option, it's never the file to open
+static bool parse_path_arg(int argc, const char **args, int *i, const char **path) {
+    if(*i + 1 >= argc) return false;
+
+    *path = args[++*i];
+    return true;
+}
+
+static bool parse_args(int argc, const char **args, Options *options) {
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(args[i], "--watch") == 0) {
+            options->watch = true;
+        } else if(strcmp(args[i], "--check") == 0) {
+            options->check = true;
+        } else if(strcmp(args[i], "--dump") == 0) {
+            options->dump = true;
+        } else if(strcmp(args[i], "--continuous") == 0) {
+            options->continuous = true;
+        } else if(strcmp(args[i], "--no-cache") == 0) {
+            options->noCache = true;
+        } else if(strcmp(args[i], "--profile") == 0) {
+            options->profile = true;
+        } else if(strcmp(args[i], "--trace") == 0) {
+            if(!parse_path_arg(argc, args, &i, &options->tracePath)) return false;
+        } else if(strcmp(args[i], "--render-png") == 0) {
+            if(!parse_path_arg(argc, args, &i, &options->renderPath)) return false;
+        } else if(strcmp(args[i], "--width") == 0) {
+            if(!parse_int_arg(argc, args, &i, &options->renderWidth)) return false;
+        } else if(strcmp(args[i], "--height") == 0) {
+            if(!parse_int_arg(argc, args, &i, &options->renderHeight)) return false;
+        } else if(options->filePath == NULL) {
+            options->filePath = args[i];
+        } else {
+            return false;
+        }
+    }
+
+    return options->filePath != NULL;
+}
+
+// lays out and draws the document into the image of the backend, then saves it
+static bool render_document(Options *options, SoftwareBackend *software, MDNode *docNode) {
+    // the blocks after the height of the image keep their estimated heights, then the
+    // document is taller than the image anyway
+    int maxHeight = options->renderHeight > 0 ? options->renderHeight : RENDER_MAX_HEIGHT;
+    // the size of the image in bytes has to fit in an int
+    int limit = INT_MAX / (4 * options->renderWidth);
+    if(maxHeight > limit) maxHeight = limit;
+
+    draw_layout_view(docNode, 0, maxHeight);
+
+    float documentHeight = ceilf(draw_document_height());
+    int height = documentHeight > maxHeight ? maxHeight : documentHeight;
+
+    if(options->renderHeight <= 0 && documentHeight > maxHeight) {
+        TraceLog(LOG_WARNING, "RENDER: The document is cropped to a height of %d pixels", height);
+    }
+
+    software_backend_begin(software, height, BACKGROUND_COLOR);
+
+    // it's drawn by strips so the batch never holds the whole document
+    for(int top = 0; top < height; top += RENDER_STRIP_HEIGHT) {
+        draw_document_region(docNode, top, top + RENDER_STRIP_HEIGHT);
+    }
+
+    return ExportImage(software->image, options->renderPath);
+}
+
+// draws the document into a png without a window, for thumbnails
+static int render_file(Options *options) {
+    CachedDocument cached = {0};
+    ParserData data = {
+        .arena = arena_create(),
+    };
+
+    MDNode *docNode;
+    if(!options->noCache && cache_load(options->filePath, &cached)) {
+        docNode = cached.docNode;
+    } else {
+        ThreadPool pool;
+        thread_pool_init(&pool, 0);
+        data.pool = &pool;
+
+        parse_file(options->filePath, &data);
+        docNode = data.docNode;
+
+        thread_pool_free(&pool);
+        data.pool = NULL;
+    }
+
+    // the document is drawn on the CPU, so it doesn't need a GPU or a display
+    SoftwareBackend software;
+    RenderBackend backend;
+    software_backend_init(&backend, &software, options->renderWidth);
+
+    bool exported = docNode != NULL && draw_init(&backend) && render_document(options, &software, docNode);
+
+    draw_unload_document();
+    backend.free(backend.data);
+    cache_close(&cached);
+    arena_free(data.arena);
+    source_file_close(&data.source);
+    return exported ? 0 : 1;
+}
+
+static int show_file(Options *options) {
+    const char *filePath = options->filePath;
+
+    // the document is parsed in the background so the window can show the first
+    // blocks while the rest are still being parsed
+    static BackgroundParser parser;
+    // the tree of a file that didn't change since it was last opened is loaded from the cache
+    static CachedDocument cached;
+    CacheWriter cacheWriter = {0};
+    bool cacheSaved = options->noCache;
+
+    // in watch mode the document is parsed by segments so a change in the file only
+    // parses again the segments that changed
+    static Document document;
+    FileWatch watch;
+    // the parser thread splits the text on it, it lives until the window is closed
+    static ThreadPool parserPool;
+
+    MDNode *docNode = NULL;
+
+    if(options->watch) {
+        if(!document_load(&document, filePath) || !watch_start(&watch, filePath, redraw_wake)) {
+            return 1;
+        }
+        docNode = &document.docNode;
+    } else if(!options->noCache && cache_load(filePath, &cached)) {
+        docNode = cached.docNode;
+        cacheSaved = true;
+    } else {
+        thread_pool_init(&parserPool, 0);
+        if(!parse_file_async(filePath, &parser, &parserPool, redraw_wake)) {
+            thread_pool_free(&parserPool);
+            return 1;
+        }
+        docNode = &parser.docNode;
+    }
+
     InitWindow(1280, 720, "C Markdown Renderer");
-    SetTargetFPS(60);
+    // scrolling is as smooth as the monitor allows
+    int refreshRate = GetMonitorRefreshRate(GetCurrentMonitor());
+    SetTargetFPS(refreshRate > 0 ? refreshRate : 60);
+
+    if(!options->continuous) redraw_start();
+
+    RaylibBackend raylib;
+    RenderBackend backend;
+    raylib_backend_init(&backend, &raylib);
 
-    draw_init();
+    // without the fonts the window is closed right away, through the same cleanup
+    bool ready = draw_init(&backend);
 
     Camera2D camera = {
         .zoom = 1,
     };
+    Scroll scroll = {0};
+    bool showOverlay = options->profile;
+
+    while(ready && !WindowShouldClose()) {
+        stats_frame_begin();
+        int64_t frameStart = stats_now();
+
+        if(IsKeyPressed(OVERLAY_TOGGLE_KEY)) {
+            showOverlay = !showOverlay;
+            redraw_invalidate();
+        }
+
+        if(options->watch) {
+            DocumentChange change;
+
+            if(watch_poll(&watch) && document_reload(&document, filePath, &change)) {
+                draw_splice_blocks(change.index, change.removed, change.added);
+                redraw_invalidate();
+
+                if(options->check && !document_check(&document)) {
+                    TraceLog(LOG_WARNING, "WATCH: [%s] The reloaded document is different from a full parse", filePath);
+                }
+            }
+        } else if(cached.docNode == NULL) {
+            // done has to be read before the last poll, so no block is left in the queue
+            bool done = parse_file_async_done(&parser);
+
+            if(parse_file_async_poll(&parser)) {
+                redraw_invalidate();
+            }
+
+            if(done && !cacheSaved) {
+                if(parser.result == 0) {
+                    cache_save_start(&cacheWriter, filePath, &parser.docNode, parser.data.source.data, parser.data.source.size);
+                }
+                cacheSaved = true;
+            }
+        }
+
+        if(scroll_has_input()) redraw_invalidate();
+
+        // a clean frame doesn't run the scroll or the layout, the loop sleeps until the
+        // next input event or wake
+        if(!options->continuous && !redraw_pending()) {
+            redraw_wait();
+            continue;
+        }
+
+        scroll_update(&scroll, draw_document_height(), GetScreenHeight());
+
+        // the blocks that become visible replace their estimated heights with the real
+        // ones, the view moves with the blocks above it so the content doesn't jump
+        float shift = draw_layout_view(docNode, scroll.y, scroll.y + GetScreenHeight());
+        scroll.y += shift;
+        scroll.target += shift;
+
+        // whole pixels so the cached tiles aren't filtered when they are copied
+        camera.target.y = roundf(scroll.y);
 
-    while(!WindowShouldClose()) {
         BeginDrawing();
-        ClearBackground(BLACK);
-
-        BeginMode2D(camera);
-        draw_document_node(data.docNode);
-        EndMode2D();
-
-        // if(IsKeyDown(KEY_DOWN) && ctx.pos.y > GetScreenHeight()) {
-        //     camera.offset.y -= 10;
-        //
-        //     float bottom = GetScreenHeight() - ctx.pos.y - padding * 2;
-        //
-        //     if(camera.offset.y < bottom) {
-        //         camera.offset.y = bottom;
-        //     }
-        // } else if(IsKeyDown(KEY_UP)) {
-        //     camera.offset.y += 10;
-        //
-        //     if(camera.offset.y > 0) {
-        //         camera.offset.y = 0;
-        //     }
-        // }
+        ClearBackground(BACKGROUND_COLOR);
+
+        draw_document_node(docNode, camera);
+
+        if(showOverlay) overlay_draw();
 
+        int64_t presentStart = stats_now();
         EndDrawing();
+        stats_add_time(STATS_PRESENT, stats_now() - presentStart);
+
+        stats_frame_end();
+        trace_event("frame", "frame", frameStart);
+    }
+
+    if(options->watch) {
+        watch_stop(&watch);
+        document_free(&document);
+    } else if(cached.docNode != NULL) {
+        cache_close(&cached);
+    } else {
+        cache_save_finish(&cacheWriter);
+        parse_file_async_free(&parser);
+        thread_pool_free(&parserPool);
     }
 
+    backend.free(backend.data);
+    if(!options->continuous) redraw_stop();
     CloseWindow();
 
-    return 0;
+    return ready ? 0 : 1;
+}
+
+int main(int argc, const char **args) {
+    Options options = {0};
+
+    if(!parse_args(argc, args, &options)) {
+        printf("Usage: ./main [--watch [--check] | --dump] [--continuous] [--no-cache] [--profile] [--trace <out.json>] <file-path>\n");
+        printf("       ./main --render-png <out.png> [--width <pixels>] [--height <pixels>] [--trace <out.json>] <file-path>\n");
+        return 1;
+    }
+
+    if(options.tracePath != NULL && !trace_start(options.tracePath)) {
+        return 1;
+    }
+    trace_thread_name("main");
+
+    int result;
+    if(options.dump) {
+        result = dump_file(options.filePath);
+    } else if(options.renderPath != NULL) {
+        if(options.renderWidth == 0) options.renderWidth = 1280;
+        result = render_file(&options);
+    } else {
+        result = show_file(&options);
+    }
+
+    trace_stop();
+    return result;
 }
@@ -0,0 +1,156 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "measure.h"
+
+#define MEASURE_INITIAL_CAPACITY 1024
+#define MAX_TABLE_CODEPOINT 0xFFFF
+
+static float glyph_advance(Font font, int index) {
+    if(font.glyphs[index].advanceX > 0) return font.glyphs[index].advanceX;
+    return font.recs[index].width + font.glyphs[index].offsetX;
+}
+
+void measure_cache_init(MeasureCache *cache, Font font) {
+    memset(cache, 0, sizeof(MeasureCache));
+    cache->font = font;
+
+    int maxCodepoint = 0;
+    for(int i = 0; i < font.glyphCount; i++) {
+        int codepoint = font.glyphs[i].value;
+        if(codepoint > maxCodepoint && codepoint <= MAX_TABLE_CODEPOINT) maxCodepoint = codepoint;
+    }
+
+    int fallbackIndex = GetGlyphIndex(font, '?');
+    cache->fallbackAdvance = glyph_advance(font, fallbackIndex);
+
+    cache->advancesCount = maxCodepoint + 1;
+    cache->advances = malloc(cache->advancesCount * sizeof(float));
+    cache->glyphIndices = malloc(cache->advancesCount * sizeof(int));
+    for(int i = 0; i < cache->advancesCount; i++) {
+        cache->advances[i] = cache->fallbackAdvance;
+        cache->glyphIndices[i] = fallbackIndex;
+    }
+
+    for(int i = 0; i < font.glyphCount; i++) {
+        int codepoint = font.glyphs[i].value;
+        if(codepoint >= 0 && codepoint < cache->advancesCount) {
+            cache->advances[codepoint] = glyph_advance(font, i);
+            cache->glyphIndices[codepoint] = i;
+        }
+    }
+
+    cache->capacity = MEASURE_INITIAL_CAPACITY;
+    cache->words = calloc(cache->capacity, sizeof(MeasuredWord));
+    cache->arena = arena_create();
+}
+
+void measure_cache_free(MeasureCache *cache) {
+    free(cache->advances);
+    free(cache->glyphIndices);
+    free(cache->words);
+    arena_free(cache->arena);
+    memset(cache, 0, sizeof(MeasureCache));
+}
+
+int measure_glyph_index(MeasureCache *cache, int codepoint) {
+    if(codepoint >= 0 && codepoint < cache->advancesCount) return cache->glyphIndices[codepoint];
+    return GetGlyphIndex(cache->font, codepoint);
+}
+
+static void measure_glyphs(MeasureCache *cache, const char *text, size_t size, float *advance, int *codepoints) {
+    *advance = 0;
+    *codepoints = 0;
+
+    for(size_t i = 0; i < size;) {
+        size_t bytes;
+        int codepoint = utf8_next_codepoint(text + i, size - i, &bytes);
+        i += bytes;
+        (*codepoints)++;
+
+        if(codepoint == '\n') continue;
+
+        if(codepoint < cache->advancesCount) {
+            *advance += cache->advances[codepoint];
+        } else {
+            *advance += glyph_advance(cache->font, GetGlyphIndex(cache->font, codepoint));
+        }
+    }
+}
+
+static uint64_t hash_word(const char *text, size_t size) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char)text[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static void grow_words(MeasureCache *cache) {
+    MeasuredWord *oldWords = cache->words;
+    size_t oldCapacity = cache->capacity;
+
+    cache->capacity *= 2;
+    cache->words = calloc(cache->capacity, sizeof(MeasuredWord));
+
+    for(size_t i = 0; i < oldCapacity; i++) {
+        if(oldWords[i].word == NULL) continue;
+
+        size_t j = oldWords[i].hash & (cache->capacity - 1);
+        while(cache->words[j].word != NULL) j = (j + 1) & (cache->capacity - 1);
+        cache->words[j] = oldWords[i];
+    }
+
+    free(oldWords);
+}
+
+static MeasuredWord *lookup_word(MeasureCache *cache, const char *text, size_t size) {
+    uint64_t hash = hash_word(text, size);
+    size_t i = hash & (cache->capacity - 1);
+
+    while(cache->words[i].word != NULL) {
+        MeasuredWord *entry = &cache->words[i];
+        if(entry->hash == hash && entry->size == size && memcmp(entry->word, text, size) == 0) {
+            return entry;
+        }
+        i = (i + 1) & (cache->capacity - 1);
+    }
+
+    // keep the load factor under 1/2
+    if((cache->count + 1) * 2 > cache->capacity) {
+        grow_words(cache);
+        return lookup_word(cache, text, size);
+    }
+
+    char *word = arena_alloc_uninit(cache->arena, size, 1);
+    memcpy(word, text, size);
+
+    MeasuredWord *entry = &cache->words[i];
+    entry->word = word;
+    entry->size = size;
+    entry->hash = hash;
+    measure_glyphs(cache, text, size, &entry->advance, &entry->codepoints);
+    cache->count++;
+
+    return entry;
+}
+
+float measure_text(MeasureCache *cache, const char *text, size_t size, float fontSize, float spacing) {
+    if(size == 0) return 0;
+
+    float advance;
+    int codepoints;
+
+    if(size <= MEASURE_MAX_CACHED_WORD) {
+        MeasuredWord *entry = lookup_word(cache, text, size);
+        advance = entry->advance;
+        codepoints = entry->codepoints;
+    } else {
+        measure_glyphs(cache, text, size, &advance, &codepoints);
+    }
+
+    float scaleFactor = fontSize / (float)cache->font.baseSize;
+    return advance * scaleFactor + (float)((codepoints - 1) * spacing);
+}
@@ -0,0 +1,50 @@
+#ifndef MEASURE_H
+#define MEASURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "raylib.h"
+#include "utils.h"
+
+// words longer than this are measured directly instead of being cached
+#define MEASURE_MAX_CACHED_WORD 64
+
+typedef struct {
+    const char *word; // interned in the arena of the cache
+    size_t size;
+    uint64_t hash;
+
+    float advance; // sum of the advances of the glyphs, in font units
+    int codepoints;
+} MeasuredWord;
+
+// Replaces MeasureTextEx for a font. The advances don't depend on the font size or the
+// spacing, those are applied after the lookup, so one cache serves every size.
+typedef struct {
+    Font font;
+
+    // glyph index and advance of every codepoint up to the biggest one of the atlas,
+    // codepoints that aren't in the atlas use the glyph of '?' like raylib does
+    int *glyphIndices;
+    float *advances;
+    int advancesCount;
+    float fallbackAdvance;
+
+    // open addressing hash map from word to its measure
+    MeasuredWord *words;
+    size_t count, capacity;
+    Arena *arena;
+} MeasureCache;
+
+void measure_cache_init(MeasureCache *cache, Font font);
+void measure_cache_free(MeasureCache *cache);
+
+// same as GetGlyphIndex but with a table lookup for the codepoints of the atlas
+int measure_glyph_index(MeasureCache *cache, int codepoint);
+
+// same result as MeasureTextEx(font, text, fontSize, spacing).x, text doesn't need to
+// be null-terminated
+float measure_text(MeasureCache *cache, const char *text, size_t size, float fontSize, float spacing);
+
+#endif // MEASURE_H
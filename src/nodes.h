@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 typedef enum {
     MD_DOCUMENT_NODE = 0,
@@ -25,6 +26,23 @@ typedef struct {
     unsigned int level;
 } MDHeaderNode;
 
+// word of a text node, it includes the spaces that follow it
+typedef struct {
+    uint32_t offset; // from the start of the text
+    uint32_t length;
+    bool breakAfter; // false for the last word of a text node if it doesn't end with a space
+} MDWord;
+
+// slice of the source of the document, it's not null-terminated
+typedef struct {
+    const char *data;
+    size_t size;
+
+    // the text is split in words once at parse time
+    MDWord *words;
+    size_t wordCount;
+} MDText;
+
 typedef struct {
     bool ordered;
     unsigned int startIndex; // from where a ordered list starts
@@ -37,7 +55,7 @@ struct MDNode {
 
     union {
         MDHeaderNode header;
-        char *text; // null-terminated string
+        MDText text;
         MDListNode list;
     };
 };
@@ -0,0 +1,92 @@
+#include <stdio.h>
+
+#include "overlay.h"
+#include "raylib.h"
+#include "stats.h"
+
+#define OVERLAY_WIDTH 300
+#define OVERLAY_MARGIN 10
+#define OVERLAY_PADDING 8
+#define OVERLAY_FONT_SIZE 10
+#define OVERLAY_LINE_HEIGHT 14
+#define OVERLAY_GRAPH_HEIGHT 60
+#define OVERLAY_GRAPH_MAX_MS 33.3f // a frame of 30 FPS fills the graph
+#define OVERLAY_BUDGET_MS (1000.0f / 60.0f)
+
+static void draw_line(int x, int *y, const char *text, Color color) {
+    DrawText(text, x, *y, OVERLAY_FONT_SIZE, color);
+    *y += OVERLAY_LINE_HEIGHT;
+}
+
+static void draw_graph(int x, int y, int width, StatsFrame *frames, size_t count) {
+    DrawRectangle(x, y, width, OVERLAY_GRAPH_HEIGHT, (Color){ 255, 255, 255, 20 });
+
+    // a bar per frame, the newest on the right
+    float barWidth = (float)width / STATS_HISTORY;
+
+    for(size_t i = 0; i < count; i++) {
+        float ms = frames[i].frameMs;
+        float height = ms / OVERLAY_GRAPH_MAX_MS * OVERLAY_GRAPH_HEIGHT;
+        if(height > OVERLAY_GRAPH_HEIGHT) height = OVERLAY_GRAPH_HEIGHT;
+
+        Rectangle bar = {
+            x + width - (count - i) * barWidth,
+            y + OVERLAY_GRAPH_HEIGHT - height,
+            barWidth,
+            height,
+        };
+        DrawRectangleRec(bar, ms > OVERLAY_BUDGET_MS ? RED : GREEN);
+    }
+
+    // the budget of a frame at 60 FPS
+    int budgetY = y + OVERLAY_GRAPH_HEIGHT - OVERLAY_BUDGET_MS / OVERLAY_GRAPH_MAX_MS * OVERLAY_GRAPH_HEIGHT;
+    DrawLine(x, budgetY, x + width, budgetY, YELLOW);
+}
+
+void overlay_draw() {
+    static StatsFrame frames[STATS_HISTORY];
+    size_t count = stats_history(frames, STATS_HISTORY);
+    if(count == 0) return;
+
+    StatsFrame *last = &frames[count - 1];
+
+    double total = 0, worst = 0;
+    for(size_t i = 0; i < count; i++) {
+        total += frames[i].frameMs;
+        if(frames[i].frameMs > worst) worst = frames[i].frameMs;
+    }
+
+    int lines = 2 + STATS_PHASE_COUNT + STATS_COUNTER_COUNT;
+    int height = OVERLAY_PADDING * 3 + OVERLAY_GRAPH_HEIGHT + lines * OVERLAY_LINE_HEIGHT;
+    int x = GetScreenWidth() - OVERLAY_WIDTH - OVERLAY_MARGIN;
+    int y = OVERLAY_MARGIN;
+
+    DrawRectangle(x, y, OVERLAY_WIDTH, height, (Color){ 0, 0, 0, 200 });
+    DrawRectangleLines(x, y, OVERLAY_WIDTH, height, GRAY);
+
+    x += OVERLAY_PADDING;
+    y += OVERLAY_PADDING;
+
+    char text[128];
+    snprintf(text, sizeof(text), "frame %.2f ms  avg %.2f  max %.2f", last->frameMs, total / count, worst);
+    draw_line(x, &y, text, WHITE);
+
+    draw_graph(x, y, OVERLAY_WIDTH - OVERLAY_PADDING * 2, frames, count);
+    y += OVERLAY_GRAPH_HEIGHT + OVERLAY_PADDING;
+
+    draw_line(x, &y, "last frame:", GRAY);
+
+    for(StatsPhase i = 0; i < STATS_PHASE_COUNT; i++) {
+        snprintf(text, sizeof(text), "%-10s %8.3f ms", stats_phase_name(i), last->phaseMs[i]);
+        draw_line(x, &y, text, LIGHTGRAY);
+    }
+
+    for(StatsCounter i = 0; i < STATS_COUNTER_COUNT; i++) {
+        if(i == STATS_ARENA_BYTES) {
+            snprintf(text, sizeof(text), "%-15s %10.2f MB", stats_counter_name(i), last->counters[i] / (1024.0 * 1024.0));
+        } else {
+            snprintf(text, sizeof(text), "%-15s %10lld", stats_counter_name(i), (long long)last->counters[i]);
+        }
+        draw_line(x, &y, text, LIGHTGRAY);
+    }
+}
@@ -0,0 +1,14 @@
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include <stdbool.h>
+
+// Profiler drawn over the document: a graph of the last frame times, the time of
+// every phase of the last frame and the counters (see stats.h).
+
+#define OVERLAY_TOGGLE_KEY KEY_F3
+
+// draws the overlay in screen coordinates, inside BeginDrawing/EndDrawing
+void overlay_draw();
+
+#endif // OVERLAY_H
@@ -1,12 +1,21 @@
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "../md4c/md4c.h"
 #include "parser.h"
 #include "raylib.h"
+#include "split.h"
+#include "stats.h"
+#include "trace.h"
 
 #define LogError(level, msg) log_error(level,  msg, __FILE__, __LINE__);
 
@@ -16,10 +25,45 @@ void log_error(TraceLogLevel level, const char *msg, const char *file, int line)
     TraceLog(level, "%s:%d: %s", file, line, msg);
 }
 
-static char *read_file(const char *filePath) {
-    FILE *filePtr = fopen(filePath, "r");
+// used when the file can't be mapped (pipes, special files, etc.)
+static bool read_file_content(int fd, SourceFile *source) {
+    size_t capacity = 4096;
+    size_t size = 0;
+    char *data = malloc(capacity);
 
-    if(filePtr == NULL) {
+    while(true) {
+        if(size == capacity) {
+            capacity *= 2;
+            data = realloc(data, capacity);
+        }
+
+        ssize_t bytes = read(fd, data + size, capacity - size);
+
+        if(bytes == 0) break;
+
+        if(bytes < 0) {
+            if(errno == EINTR) continue;
+
+            const char *msg = TextFormat("Couldn't read the file (errno: %d)", errno);
+            LogError(LOG_ERROR, msg);
+            free(data);
+            return false;
+        }
+
+        size += bytes;
+    }
+
+    source->data = data;
+    source->size = size;
+    source->mapped = false;
+    return true;
+}
+
+bool read_file(const char *filePath, SourceFile *source, bool allowMap) {
+    int64_t start = stats_now();
+    int fd = open(filePath, O_RDONLY);
+
+    if(fd == -1) {
         switch(errno) {
             case ENOENT:
                 LogError(LOG_ERROR, "No such file or directory");
@@ -32,31 +76,66 @@ static char *read_file(const char *filePath) {
                 LogError(LOG_ERROR, msg);
                 break;
         }
-        return NULL;
+        return false;
     }
 
-    fseek(filePtr, 0, SEEK_END);
-    long length = ftell(filePtr);
-    rewind(filePtr);
+    struct stat st;
+    bool ok = false;
+
+    if(allowMap && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        if((unsigned long long) st.st_size > UINT_MAX) {
+            // md4c uses an unsigned int for the size of the document
+            LogError(LOG_ERROR, "The file size is way too big");
+            close(fd);
+            return false;
+        }
+
+        // the text nodes point directly into the mapping, so there's no copy of the file
+        void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
 
-    if(length == -1 || (unsigned long) length >= SIZE_MAX) {
+        if(data != MAP_FAILED) {
+            madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+            source->data = data;
+            source->size = st.st_size;
+            source->mapped = true;
+            ok = true;
+        }
+    }
+
+    if(!ok) {
+        ok = read_file_content(fd, source);
+    }
+
+    close(fd);
+
+    if(ok && source->size > UINT_MAX) {
         LogError(LOG_ERROR, "The file size is way too big");
-        return NULL;
+        source_file_close(source);
+        return false;
     }
 
-    size_t ulength = (size_t) length;
-    char *text = malloc(ulength + 1);
+    if(ok) trace_event_arg("io", "read_file", start, "bytes", source->size);
+    return ok;
+}
 
-    fread(text, 1, ulength, filePtr);
+void source_file_close(SourceFile *source) {
+    if(source->data == NULL) return;
 
-    text[ulength] = '\0';
+    if(source->mapped) {
+        munmap((void *)source->data, source->size);
+    } else {
+        free((void *)source->data);
+    }
 
-    return text;
+    source->data = NULL;
+    source->size = 0;
 }
 
 static MDNode *alloc_node(ParserData *parserData, MDNodeType type) {
-    MDNode *node = arena_alloc(parserData->arena, sizeof(MDNode));
+    MDNode *node = arena_new(parserData->arena, MDNode);
     node->type = type;
+    parserData->nodeCount++;
     return node;
 }
 
@@ -83,12 +162,57 @@ static MDNode *get_parent_node(ParserData *parserData) {
     return parentNode;
 }
 
+// every block of the scratch arena starts with its size, md4c doesn't pass it when a
+// block is grown, the header keeps the memory after it aligned like malloc
+#define SCRATCH_HEADER_SIZE ARENA_DEFAULT_ALIGNMENT
+
+static void *scratch_realloc(void *ptr, size_t size, void *userData) {
+    Arena *scratch = ((ParserData *)userData)->scratch;
+
+    char *block = ptr == NULL ? NULL : (char *)ptr - SCRATCH_HEADER_SIZE;
+    size_t oldSize = block == NULL ? 0 : *(size_t *)block;
+
+    block = arena_realloc(scratch, block, SCRATCH_HEADER_SIZE + oldSize, SCRATCH_HEADER_SIZE + size);
+    *(size_t *)block = size;
+    return block + SCRATCH_HEADER_SIZE;
+}
+
+// the last block of a region is given back so the next one can use its space, the
+// others are freed with the whole arena after the parse
+static void scratch_free(void *ptr, void *userData) {
+    if(ptr == NULL) return;
+
+    Arena *scratch = ((ParserData *)userData)->scratch;
+
+    char *block = (char *)ptr - SCRATCH_HEADER_SIZE;
+    arena_release(scratch, block, SCRATCH_HEADER_SIZE + *(size_t *)block);
+}
+
+static void flush_trace_batch(ParserData *parserData) {
+    if(parserData->traceCallbacks == 0) return;
+
+    trace_event_arg("parse", "md4c callbacks", parserData->traceBatchStart, "callbacks", parserData->traceCallbacks);
+    parserData->traceCallbacks = 0;
+}
+
+// the callbacks are traced in batches, an event for each one would cost more than
+// the callbacks themselves
+static void trace_callback(ParserData *parserData) {
+    if(!trace_enabled()) return;
+
+    if(parserData->traceCallbacks == 0) parserData->traceBatchStart = stats_now();
+    if(++parserData->traceCallbacks == PARSER_TRACE_BATCH) flush_trace_batch(parserData);
+}
+
 static int handle_enter_block(MD_BLOCKTYPE type, void *detail, void *dataPtr) {
     ParserData *parserData = dataPtr;
+    trace_callback(parserData);
 
     if(type == MD_BLOCK_DOC) {
         parserData->docNode = alloc_node(parserData, MD_DOCUMENT_NODE);
         stack_push(&parserData->parentStack, parserData->docNode);
+
+        if(parserData->flatTree != NULL) flat_tree_open(parserData->flatTree, parserData->docNode);
         return 0;
     }
 
@@ -131,25 +255,57 @@ static int handle_enter_block(MD_BLOCKTYPE type, void *detail, void *dataPtr) {
             return 1;
     }
 
-    add_children_to_node(parentNode, node);
+    // the top-level blocks will be added by the thread that receives them
+    if(parserData->blockQueue == NULL || parentNode != parserData->docNode) {
+        add_children_to_node(parentNode, node);
+    }
+
+    if(parserData->flatTree != NULL) flat_tree_open(parserData->flatTree, node);
 
     return 0;
 }
 
+static int publish_block(ParserData *parserData, MDNode *node) {
+    while(!spsc_queue_push(parserData->blockQueue, node)) {
+        if(atomic_load(parserData->cancel)) return 1;
+        sched_yield();
+    }
+
+    if(parserData->notify != NULL && !atomic_exchange(&parserData->notified, true)) {
+        parserData->notify();
+    }
+
+    return atomic_load(parserData->cancel) ? 1 : 0;
+}
+
 static int handle_leave_block(MD_BLOCKTYPE type, void *detail, void *userData) {
     ParserData *parserData = userData;
+    trace_callback(parserData);
 
     if(parserData->parentStack.count == 0) {
         LogError(LOG_ERROR, "There's no items in the parentStack");
         return 1;
     }
 
-    stack_pop(&parserData->parentStack);
+    MDNode *node = stack_pop(&parserData->parentStack);
+
+    if(parserData->flatTree != NULL) flat_tree_close(parserData->flatTree);
+
+    // the parts of a parallel parse don't publish blocks, so they check it here
+    if(parserData->cancel != NULL && parserData->parentStack.count == 1 && atomic_load(parserData->cancel)) {
+        return 1;
+    }
+
+    if(parserData->blockQueue != NULL && type != MD_BLOCK_DOC && parserData->parentStack.count == 1) {
+        return publish_block(parserData, node);
+    }
+
     return 0;
 }
 
 static int handle_enter_span(MD_SPANTYPE type, void *detail, void *userData) {
     ParserData *parserData = userData;
+    trace_callback(parserData);
 
     MDNode *parentNode = get_parent_node(parserData);
     if(parentNode == NULL) {
@@ -170,11 +326,14 @@ static int handle_enter_span(MD_SPANTYPE type, void *detail, void *userData) {
 
     add_children_to_node(parentNode, node);
 
+    if(parserData->flatTree != NULL) flat_tree_open(parserData->flatTree, node);
+
     return 0;
 }
 
 static int handle_leave_span(MD_SPANTYPE type, void *detail, void *userData) {
     ParserData *parserData = userData;
+    trace_callback(parserData);
 
     if(parserData->parentStack.count == 0) {
         LogError(LOG_ERROR, "There's no items in the parentStack");
@@ -182,11 +341,57 @@ static int handle_leave_span(MD_SPANTYPE type, void *detail, void *userData) {
     }
 
     stack_pop(&parserData->parentStack);
+
+    if(parserData->flatTree != NULL) flat_tree_close(parserData->flatTree);
+
     return 0;
 }
 
+// returns the end of the word that starts at pos, the spaces that follow it are included
+static size_t find_word_end(const char *text, size_t size, size_t pos) {
+    const char *space = memchr(text + pos, ' ', size - pos);
+    return space == NULL ? size : (size_t)(space - text) + 1;
+}
+
+static void add_text_node(ParserData *parserData, MDNode *parentNode, const char *text, size_t size) {
+    MDNode *textNode = alloc_node(parserData, MD_TEXT_NODE);
+
+    // md4c gives us slices of the source (or static strings), so there's no need to copy them
+    textNode->text.data = text;
+    textNode->text.size = size;
+
+    size_t wordCount = 0;
+    for(size_t pos = 0; pos < size; pos = find_word_end(text, size, pos)) {
+        wordCount++;
+    }
+
+    // every field of the words is set below
+    textNode->text.words = arena_new_array_uninit(parserData->arena, MDWord, wordCount);
+    textNode->text.wordCount = wordCount;
+
+    size_t wordStart = 0;
+    for(size_t i = 0; i < wordCount; i++) {
+        size_t wordEnd = find_word_end(text, size, wordStart);
+
+        MDWord *word = &textNode->text.words[i];
+        word->offset = wordStart;
+        word->length = wordEnd - wordStart;
+        word->breakAfter = text[wordEnd - 1] == ' ';
+
+        wordStart = wordEnd;
+    }
+
+    add_children_to_node(parentNode, textNode);
+
+    if(parserData->flatTree != NULL) {
+        flat_tree_open(parserData->flatTree, textNode);
+        flat_tree_close(parserData->flatTree);
+    }
+}
+
 static int handle_text(MD_TEXTTYPE type, const MD_CHAR *text, MD_SIZE size, void *userData) {
     ParserData *parserData = userData;
+    trace_callback(parserData);
     MDNode *parentNode = get_parent_node(parserData);
     if(parentNode == NULL) {
         return 1;
@@ -194,14 +399,7 @@ static int handle_text(MD_TEXTTYPE type, const MD_CHAR *text, MD_SIZE size, void
 
     switch(type) {
         case MD_TEXT_NORMAL:
-            MDNode *textNode = alloc_node(parserData, MD_TEXT_NODE);
-
-            // copy the text into the ode
-            textNode->text = arena_alloc(parserData->arena, size + 1);
-            memcpy(textNode->text, text, size);
-            textNode->text[size] = '\0';
-
-            add_children_to_node(parentNode, textNode);
+            add_text_node(parserData, parentNode, text, size);
             break;
         default:
             LogError(LOG_ERROR, "Text type not supported");
@@ -210,12 +408,8 @@ static int handle_text(MD_TEXTTYPE type, const MD_CHAR *text, MD_SIZE size, void
     return 0;
 }
 
-void parse_file(const char *filePath, ParserData *parserData) {
-    char *content = read_file(filePath);
-
-    if(content == NULL) return;
-
-    MD_PARSER parser = {
+static MD_PARSER md_parser_options() {
+    return (MD_PARSER){
         .abi_version = 0,
         .flags = MD_FLAG_NOHTML | MD_FLAG_TABLES | MD_FLAG_TASKLISTS | MD_FLAG_LATEXMATHSPANS | MD_FLAG_WIKILINKS,
 
@@ -225,6 +419,274 @@ void parse_file(const char *filePath, ParserData *parserData) {
         .leave_span = &handle_leave_span,
         .text = &handle_text,
     };
+}
+
+MD_PARSER_CTX *parser_context_create() {
+    // the buffers of a context outlive the parses, so they can't go in the scratch arena
+    MD_PARSER parser = md_parser_options();
+    return md_parser_create(&parser);
+}
+
+void parser_context_reset(MD_PARSER_CTX *context) {
+    md_parser_reset(context);
+}
+
+void parser_context_free(MD_PARSER_CTX *context) {
+    md_parser_destroy(context);
+}
+
+int parse_text(ParserData *parserData, const char *text, size_t size) {
+    size_t nodeCount = parserData->nodeCount;
+    int64_t start = stats_now();
+    int result;
+
+    if(parserData->context != NULL) {
+        result = md_parser_parse(parserData->context, text, size, parserData);
+    } else {
+        MD_PARSER parser = md_parser_options();
+        parser.mem_realloc = &scratch_realloc;
+        parser.mem_free = &scratch_free;
+
+        // a single arena per parse, so the threads that parse in parallel don't share the
+        // allocator and all of md4c's memory is released at once
+        parserData->scratch = arena_create();
+        result = md_parse(text, size, &parser, parserData);
+
+        parserData->scratchBytes += arena_stats(parserData->scratch).reserved;
+        arena_free(parserData->scratch);
+        parserData->scratch = NULL;
+    }
+
+    flush_trace_batch(parserData);
+    trace_event_arg("parse", "md_parse", start, "bytes", size);
+
+    // counted once per parse, so the threads that parse in parallel don't share a counter
+    stats_add(STATS_NODES_PARSED, parserData->nodeCount - nodeCount);
+    return result;
+}
+
+typedef struct {
+    const char *text;
+    size_t size;
+    ParserData data;
+    int result;
+} ParserChunk;
+
+static void parse_chunk_task(void *data, size_t index, size_t worker) {
+    ParserChunk *chunk = &((ParserChunk *)data)[index];
+    chunk->result = parse_text(&chunk->data, chunk->text, chunk->size);
+}
+
+// true if the text only has link reference definitions, so putting it before a
+// part of the document doesn't add blocks to it
+static bool only_ref_defs(const char *text, size_t size) {
+    ParserData data = {
+        .arena = arena_create(),
+    };
+
+    bool result = parse_text(&data, text, size) == 0
+        && data.docNode != NULL
+        && data.docNode->children.count == 0;
+
+    arena_free(data.arena);
+    return result;
+}
+
+int parse_text_parallel(ParserData *parserData, const char *text, size_t size) {
+    // the flat tree is built in pre-order while parsing, so it needs a single parse
+    if(parserData->flatTree != NULL || size < PARSER_PARALLEL_MIN_CHUNK * 2) {
+        return parse_text(parserData, text, size);
+    }
+
+    ThreadPool *pool = parserData->pool;
+    if(pool == NULL || pool->threadCount == 1) {
+        return parse_text(parserData, text, size);
+    }
+
+    // the definitions are global, so all of them go before every part
+    char *refDefs = NULL;
+    size_t refDefsSize = 0;
+
+    if(split_has_ref_defs(text, size)) {
+        refDefs = split_gather_ref_defs(text, size, &refDefsSize);
+
+        if(refDefs == NULL || !only_ref_defs(refDefs, refDefsSize)) {
+            free(refDefs);
+            return parse_text(parserData, text, size);
+        }
+    }
+
+    // a few parts per thread so a slow part doesn't keep the others waiting
+    size_t chunkSize = size / (pool->threadCount * 4);
+    if(chunkSize < PARSER_PARALLEL_MIN_CHUNK) chunkSize = PARSER_PARALLEL_MIN_CHUNK;
+
+    size_t capacity = 16;
+    size_t count = 0;
+    ParserChunk *chunks = malloc(capacity * sizeof(ParserChunk));
+
+    size_t pos = 0;
+    while(pos < size) {
+        // the boundaries have to be found from the previous one, since the splitter
+        // has to know if it's inside a fenced code block
+        size_t end = pos;
+        do {
+            end = split_next_boundary(text, size, end);
+        } while(end < size && end - pos < chunkSize);
+
+        if(count == capacity) {
+            capacity *= 2;
+            chunks = realloc(chunks, capacity * sizeof(ParserChunk));
+        }
+
+        ParserChunk *chunk = &chunks[count++];
+        memset(chunk, 0, sizeof(ParserChunk));
+        chunk->data.arena = arena_create();
+        chunk->data.cancel = parserData->cancel;
+        chunk->text = text + pos;
+        chunk->size = end - pos;
+
+        // every part gets its own copy with the definitions before it, the nodes point
+        // into it, so the document keeps a second copy of the text
+        if(refDefs != NULL) {
+            char *copy = arena_alloc_uninit(chunk->data.arena, refDefsSize + chunk->size, 1);
+            memcpy(copy, refDefs, refDefsSize);
+            memcpy(copy + refDefsSize, chunk->text, chunk->size);
+            chunk->text = copy;
+            chunk->size += refDefsSize;
+        }
+
+        pos = end;
+    }
+
+    free(refDefs);
+
+    int result = 0;
+
+    if(count == 1) {
+        // there's no safe boundary to split the text
+        arena_free(chunks[0].data.arena);
+        result = parse_text(parserData, text, size);
+    } else {
+        thread_pool_run(pool, parse_chunk_task, chunks, count);
+
+        if(parserData->docNode == NULL) {
+            parserData->docNode = alloc_node(parserData, MD_DOCUMENT_NODE);
+        }
+
+        // the blocks of every part go to the document in order
+        for(size_t i = 0; i < count; i++) {
+            ParserChunk *chunk = &chunks[i];
+
+            // like a single parse that fails, the document keeps the blocks before the
+            // error and the parts after it are dropped
+            if(result != 0) {
+                arena_free(chunk->data.arena);
+                continue;
+            }
+
+            MDNode *node = chunk->data.docNode != NULL ? chunk->data.docNode->children.head : NULL;
+
+            while(node != NULL && result == 0) {
+                MDNode *next = node->next;
+                node->next = NULL;
+
+                if(parserData->blockQueue != NULL) {
+                    result = publish_block(parserData, node);
+                } else {
+                    add_children_to_node(parserData->docNode, node);
+                }
+
+                node = next;
+            }
+
+            arena_merge(parserData->arena, chunk->data.arena);
+            parserData->scratchBytes += chunk->data.scratchBytes;
+
+            if(result == 0) result = chunk->result;
+        }
+    }
+
+    free(chunks);
+
+    return result;
+}
+
+void parse_file(const char *filePath, ParserData *parserData) {
+    if(!read_file(filePath, &parserData->source, true)) return;
+
+    if(parserData->flatTree != NULL) {
+        flat_tree_init(parserData->flatTree, parserData->source.data, parserData->source.size);
+    }
+
+    parse_text_parallel(parserData, parserData->source.data, parserData->source.size);
+}
+
+static void *parse_worker(void *arg) {
+    BackgroundParser *parser = arg;
+    trace_thread_name("parser");
+
+    SourceFile *source = &parser->data.source;
+    parser->result = parse_text_parallel(&parser->data, source->data, source->size);
+    atomic_store_explicit(&parser->done, true, memory_order_release);
+    if(parser->data.notify != NULL) parser->data.notify();
+
+    return NULL;
+}
+
+bool parse_file_async(const char *filePath, BackgroundParser *parser, ThreadPool *pool, void (*notify)(void)) {
+    memset(parser, 0, sizeof(BackgroundParser));
+
+    // reading is cheap since the file is mapped, so the errors are reported right away
+    if(!read_file(filePath, &parser->data.source, true)) return false;
+
+    parser->docNode.type = MD_DOCUMENT_NODE;
+    parser->data.arena = arena_create();
+    parser->data.blockQueue = &parser->queue;
+    parser->data.cancel = &parser->cancel;
+    parser->data.notify = notify;
+    parser->data.pool = pool;
+
+    if(pthread_create(&parser->thread, NULL, parse_worker, parser) != 0) {
+        LogError(LOG_ERROR, "Couldn't create the parser thread");
+        arena_free(parser->data.arena);
+        source_file_close(&parser->data.source);
+        memset(parser, 0, sizeof(BackgroundParser));
+        return false;
+    }
+
+    return true;
+}
+
+bool parse_file_async_poll(BackgroundParser *parser) {
+    bool added = false;
+    MDNode *node;
+
+    // the blocks pushed after this notify again
+    atomic_store(&parser->data.notified, false);
+
+    while((node = spsc_queue_pop(&parser->queue)) != NULL) {
+        add_children_to_node(&parser->docNode, node);
+        added = true;
+    }
+
+    return added;
+}
+
+bool parse_file_async_done(BackgroundParser *parser) {
+    // the blocks are pushed before done is set, so after this the queue only needs a last poll
+    return atomic_load_explicit(&parser->done, memory_order_acquire);
+}
+
+void parse_file_async_stop(BackgroundParser *parser) {
+    atomic_store(&parser->cancel, true);
+    pthread_join(parser->thread, NULL);
+}
+
+void parse_file_async_free(BackgroundParser *parser) {
+    parse_file_async_stop(parser);
 
-    md_parse(content, strlen(content), &parser, parserData);
+    // the queue is part of the parser, the blocks left in it are in the arena
+    arena_free(parser->data.arena);
+    source_file_close(&parser->data.source);
+    memset(parser, 0, sizeof(BackgroundParser));
 }
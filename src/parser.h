@@ -1,15 +1,113 @@
 #ifndef PARSER_H
 #define PARSER_H
 
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "flattree.h"
 #include "nodes.h"
 #include "utils.h"
 
+// texts smaller than twice this are parsed in a single thread
+#define PARSER_PARALLEL_MIN_CHUNK (1 << 20)
+// md4c callbacks recorded by a single trace event
+#define PARSER_TRACE_BATCH 4096
+
+// md4c's parser object, it keeps its buffers between the parses (see md4c.h)
+typedef struct MD_PARSER_CTX_tag MD_PARSER_CTX;
+
+// content of the file being parsed, the text nodes point into it so it has to
+// outlive the document
+typedef struct {
+    const char *data;
+    size_t size;
+    bool mapped; // data is a mmap of the file instead of a malloc'd buffer
+} SourceFile;
+
 typedef struct {
     Arena *arena;
+    SourceFile source;
     MDNode *docNode;
     Stack parentStack;
+
+    // when it's not NULL the top-level blocks are pushed here once they are
+    // finished instead of being added to docNode
+    SPSCQueue *blockQueue;
+    atomic_bool *cancel;
+    // called by the parser thread when there are new blocks in blockQueue, only once
+    // until they are polled, so a consumer can sleep until then
+    void (*notify)(void);
+    atomic_bool notified;
+
+    // parse_text_parallel parses the parts of the text on it, the text is parsed at once
+    // without it, the pool outlives the parses so its threads are only started once
+    ThreadPool *pool;
+
+    // when it's not NULL the nodes are also added to it, in pre-order
+    // parse_file initializes it once the file is read
+    MDFlatTree *flatTree;
+
+    size_t nodeCount; // nodes allocated so far, for the statistics
+
+    // when it's not NULL the text is parsed with it, instead of a new md4c parser that
+    // puts its buffers in the scratch arena
+    MD_PARSER_CTX *context;
+
+    // md4c's own buffers, only alive during a parse (see parse_text)
+    Arena *scratch;
+    size_t scratchBytes; // reserved by the scratch arenas, summed over the parses
+
+    // callbacks of the batch that is being traced (see trace.h)
+    size_t traceCallbacks;
+    int64_t traceBatchStart;
 } ParserData;
 
+// parses the file in a worker thread, the finished top-level blocks are moved
+// into docNode by parse_file_async_poll so they can be shown before the parsing ends
+typedef struct {
+    ParserData data;
+    pthread_t thread;
+    SPSCQueue queue;
+    atomic_bool cancel;
+    atomic_bool done;
+    int result; // result of md_parse, only valid once done is true
+
+    // blocks received so far, owned by the thread that calls parse_file_async_poll
+    MDNode docNode;
+} BackgroundParser;
+
+// for parsing a lot of small texts, the context is given to ParserData.context so the
+// fixed cost of md4c's buffers is only paid once, a context is used by a thread at a time
+MD_PARSER_CTX *parser_context_create();
+// releases the buffers, the context can still be used
+void parser_context_reset(MD_PARSER_CTX *context);
+void parser_context_free(MD_PARSER_CTX *context);
+
 void parse_file(const char *filePath, ParserData *parserData);
+// parses text into parserData->docNode, text has to outlive the nodes
+int parse_text(ParserData *parserData, const char *text, size_t size);
+// same as parse_text, but big texts are split at safe boundaries (see split.h) and the
+// parts are parsed in parallel, each one in its own arena that is merged at the end
+// it parses the whole text at once if it can't be split, if there's a flat tree or no pool
+// when a part fails the document has the blocks of the parts before it, like a single
+// parse keeps the blocks before the error
+int parse_text_parallel(ParserData *parserData, const char *text, size_t size);
+
+// regular files are mapped when allowMap is true, otherwise the content is copied
+bool read_file(const char *filePath, SourceFile *source, bool allowMap);
+void source_file_close(SourceFile *source);
+
+// the file is read before returning, so it returns false if it can't be read
+// the pool and notify can be NULL, see ParserData, notify is called from the parser
+// thread when there are new blocks to poll and when the parser is done
+bool parse_file_async(const char *filePath, BackgroundParser *parser, ThreadPool *pool, void (*notify)(void));
+// returns true if new blocks were added to parser->docNode
+bool parse_file_async_poll(BackgroundParser *parser);
+bool parse_file_async_done(BackgroundParser *parser);
+// stops the worker thread and waits for it
+void parse_file_async_stop(BackgroundParser *parser);
+// stops the worker thread and frees the blocks and the file, docNode can't be used after it
+void parse_file_async_free(BackgroundParser *parser);
 
 #endif // PARSER_H
@@ -0,0 +1,149 @@
+#include <math.h>
+
+#include "raster.h"
+
+typedef struct {
+    float x0, y0, dx, dy;
+} Edge;
+
+static float edge_at(Edge *edge, float x, float y) {
+    return edge->dx * (y - edge->y0) - edge->dy * (x - edge->x0);
+}
+
+// a pixel center on an edge shared by two quads only belongs to one of them, the one
+// that goes through the edge in this direction
+static bool edge_owns(Edge *edge) {
+    return edge->dy > 0 || (edge->dy == 0 && edge->dx < 0);
+}
+
+static Color sample(RasterTexture *texture, float u, float v) {
+    if(texture == NULL) return WHITE;
+
+    // same as GL_LINEAR with GL_CLAMP_TO_EDGE, the texels are at their centers
+    float x = u * texture->width - 0.5f;
+    float y = v * texture->height - 0.5f;
+    int x0 = floorf(x);
+    int y0 = floorf(y);
+    float fx = x - x0;
+    float fy = y - y0;
+
+    int xs[2] = { x0, x0 + 1 };
+    int ys[2] = { y0, y0 + 1 };
+    for(int i = 0; i < 2; i++) {
+        if(xs[i] < 0) xs[i] = 0;
+        if(xs[i] >= texture->width) xs[i] = texture->width - 1;
+        if(ys[i] < 0) ys[i] = 0;
+        if(ys[i] >= texture->height) ys[i] = texture->height - 1;
+    }
+
+    Color c00 = texture->pixels[ys[0] * texture->width + xs[0]];
+    Color c10 = texture->pixels[ys[0] * texture->width + xs[1]];
+    Color c01 = texture->pixels[ys[1] * texture->width + xs[0]];
+    Color c11 = texture->pixels[ys[1] * texture->width + xs[1]];
+
+    float w00 = (1 - fx) * (1 - fy);
+    float w10 = fx * (1 - fy);
+    float w01 = (1 - fx) * fy;
+    float w11 = fx * fy;
+
+    return (Color){
+        c00.r * w00 + c10.r * w10 + c01.r * w01 + c11.r * w11 + 0.5f,
+        c00.g * w00 + c10.g * w10 + c01.g * w01 + c11.g * w11 + 0.5f,
+        c00.b * w00 + c10.b * w10 + c01.b * w01 + c11.b * w11 + 0.5f,
+        c00.a * w00 + c10.a * w10 + c01.a * w01 + c11.a * w11 + 0.5f,
+    };
+}
+
+static void raster_quad(BatchQuad *quad, RasterTexture *texture, Image *target, int top, int bottom) {
+    Vector2 *p = quad->pos;
+
+    // the quads are convex, the edges are oriented so the inside is positive
+    float area = 0;
+    for(int i = 0; i < 4; i++) {
+        Vector2 a = p[i], b = p[(i + 1) % 4];
+        area += a.x * b.y - b.x * a.y;
+    }
+    if(area == 0) return;
+
+    Edge edges[4];
+    for(int i = 0; i < 4; i++) {
+        Vector2 a = area > 0 ? p[i] : p[(i + 1) % 4];
+        Vector2 b = area > 0 ? p[(i + 1) % 4] : p[i];
+        edges[i] = (Edge){ a.x, a.y, b.x - a.x, b.y - a.y };
+    }
+
+    // the uvs are an affine map of the positions (the quads are parallelograms, or use
+    // a single color)
+    Vector2 e1 = { p[1].x - p[0].x, p[1].y - p[0].y };
+    Vector2 e3 = { p[3].x - p[0].x, p[3].y - p[0].y };
+    float det = e1.x * e3.y - e1.y * e3.x;
+    if(det == 0) return;
+
+    float minX = p[0].x, maxX = p[0].x, minY = p[0].y, maxY = p[0].y;
+    for(int i = 1; i < 4; i++) {
+        minX = fminf(minX, p[i].x);
+        maxX = fmaxf(maxX, p[i].x);
+        minY = fminf(minY, p[i].y);
+        maxY = fmaxf(maxY, p[i].y);
+    }
+
+    int startX = fmaxf(floorf(minX), 0);
+    int endX = fminf(ceilf(maxX), target->width);
+    int startY = fmaxf(floorf(minY), top);
+    int endY = fminf(ceilf(maxY), bottom);
+
+    Color *pixels = target->data;
+
+    for(int y = startY; y < endY; y++) {
+        for(int x = startX; x < endX; x++) {
+            float cx = x + 0.5f, cy = y + 0.5f;
+
+            bool inside = true;
+            for(int i = 0; i < 4 && inside; i++) {
+                float value = edge_at(&edges[i], cx, cy);
+                inside = value > 0 || (value == 0 && edge_owns(&edges[i]));
+            }
+            if(!inside) continue;
+
+            float dx = cx - p[0].x, dy = cy - p[0].y;
+            float a = (dx * e3.y - dy * e3.x) / det;
+            float b = (e1.x * dy - e1.y * dx) / det;
+            float u = quad->uv[0].x + a * (quad->uv[1].x - quad->uv[0].x) + b * (quad->uv[3].x - quad->uv[0].x);
+            float v = quad->uv[0].y + a * (quad->uv[1].y - quad->uv[0].y) + b * (quad->uv[3].y - quad->uv[0].y);
+
+            Color texel = sample(texture, u, v);
+            float alpha = texel.a * quad->color.a / (255.0f * 255.0f);
+            if(alpha <= 0) continue;
+
+            // the default blending of rlgl: src * alpha + dst * (1 - alpha)
+            Color *dst = &pixels[y * target->width + x];
+            dst->r = texel.r * quad->color.r / 255.0f * alpha + dst->r * (1 - alpha) + 0.5f;
+            dst->g = texel.g * quad->color.g / 255.0f * alpha + dst->g * (1 - alpha) + 0.5f;
+            dst->b = texel.b * quad->color.b / 255.0f * alpha + dst->b * (1 - alpha) + 0.5f;
+            dst->a = 255 * alpha + dst->a * (1 - alpha) + 0.5f;
+        }
+    }
+}
+
+void raster_flush(
+    RenderBatch *batch, Image *target, int top, int bottom,
+    RasterTexture *textures, size_t count
+) {
+    if(top < 0) top = 0;
+    if(bottom > target->height) bottom = target->height;
+
+    for(size_t i = 0; i < batch->count; i++) {
+        BatchLayer *layer = &batch->layers[i];
+
+        RasterTexture *texture = NULL;
+        for(size_t j = 0; j < count; j++) {
+            if(textures[j].id == layer->texture.id) texture = &textures[j];
+        }
+
+        for(size_t j = 0; j < layer->count; j++) {
+            raster_quad(&layer->quads[j], texture, target, top, bottom);
+        }
+
+        layer->count = 0;
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <stddef.h>
+
+#include "batch.h"
+#include "raylib.h"
+
+// Draws the quads of a RenderBatch into an image on the CPU, so a document can be
+// rendered without a GPU or a window. The result is close to what rlgl draws: the
+// textures are sampled with bilinear filtering and blended with the alpha.
+
+// pixels of a texture used by the batch, the textures that aren't given are white
+// (like the one of the shapes)
+typedef struct {
+    unsigned int id;
+    Color *pixels;
+    int width, height;
+} RasterTexture;
+
+// target has to be PIXELFORMAT_UNCOMPRESSED_R8G8B8A8, only its rows [top, bottom) are
+// drawn so a quad that is in two calls isn't blended twice
+void raster_flush(
+    RenderBatch *batch, Image *target, int top, int bottom,
+    RasterTexture *textures, size_t count
+);
+
+#endif // RASTER_H
@@ -0,0 +1,60 @@
+#include <stdatomic.h>
+
+#include "raylib.h"
+#include "redraw.h"
+#include "stats.h"
+#include "trace.h"
+
+// raylib is built with GLFW but it doesn't have a function to wake the event loop
+void glfwPostEmptyEvent(void);
+
+// it can be invalidated from other threads
+static atomic_bool invalidated = true;
+static bool wasFocused = false;
+static atomic_bool waiting = false;
+
+void redraw_invalidate() {
+    atomic_store(&invalidated, true);
+    redraw_wake();
+}
+
+bool redraw_pending() {
+    bool pending = atomic_exchange(&invalidated, false);
+
+    if(IsWindowResized()) pending = true;
+
+    // the window may need to be repainted when it gets back the focus
+    bool focused = IsWindowFocused();
+    if(focused != wasFocused) {
+        wasFocused = focused;
+        pending = true;
+    }
+
+    return pending;
+}
+
+void redraw_start() {
+    atomic_store(&waiting, true);
+}
+
+void redraw_stop() {
+    atomic_store(&waiting, false);
+}
+
+void redraw_wake() {
+    // before the window is open there's no loop to wake
+    if(atomic_load(&waiting)) glfwPostEmptyEvent();
+}
+
+void redraw_wait() {
+    // only this poll waits, the one at the end of EndDrawing doesn't, so the time of a
+    // frame doesn't include the wait for the next event
+    // a wake while the frame was drawn was already posted, so the wait returns at once
+    int64_t start = stats_now();
+    if(atomic_load(&waiting)) EnableEventWaiting();
+    PollInputEvents();
+    DisableEventWaiting();
+
+    // the idle time is its own slice, the frames before and after it stay short
+    trace_event("frame", "wait", start);
+}
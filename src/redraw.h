@@ -0,0 +1,27 @@
+#ifndef REDRAW_H
+#define REDRAW_H
+
+#include <stdbool.h>
+
+// the window is only drawn again when something changed, so a static document doesn't
+// use the CPU or the GPU
+// anything that changes what is on screen (layout, scroll, file changes, animations)
+// calls redraw_invalidate, an animation calls it every frame while it's running
+void redraw_invalidate();
+
+// true if the next frame has to be drawn, it also checks resizes and focus changes
+bool redraw_pending();
+
+// the window has to be open, from then on redraw_wait sleeps until there's an input event
+// or a wake, redraw_stop goes back to polling
+void redraw_start();
+void redraw_stop();
+
+// wakes the loop without drawing a frame, for work that the loop polls (the parser, the
+// file watch), it can be called from any thread
+void redraw_wake();
+
+// used instead of drawing a frame, it sleeps until the next event after redraw_start
+void redraw_wait();
+
+#endif // REDRAW_H
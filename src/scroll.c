@@ -0,0 +1,64 @@
+#include <math.h>
+
+#include "raylib.h"
+#include "redraw.h"
+#include "scroll.h"
+
+#define SCROLL_WHEEL_STEP 80
+#define SCROLL_KEY_SPEED 900 // pixels per second while an arrow is held
+#define SCROLL_PAGE_FACTOR 0.9f // page up/down keep a bit of the previous page visible
+// how fast y reaches the target, higher is faster
+#define SCROLL_SMOOTHNESS 18
+// after being idle the next frame shouldn't move as if a lot of time passed
+#define SCROLL_MAX_FRAME_TIME (1.0 / 30.0)
+
+static float clamp_scroll(float y, float maxY) {
+    if(y > maxY) y = maxY;
+    if(y < 0) y = 0;
+    return y;
+}
+
+bool scroll_has_input() {
+    return GetMouseWheelMove() != 0
+        || IsKeyPressed(KEY_PAGE_DOWN) || IsKeyPressed(KEY_PAGE_UP)
+        || IsKeyPressed(KEY_HOME) || IsKeyPressed(KEY_END)
+        || IsKeyDown(KEY_DOWN) || IsKeyDown(KEY_UP);
+}
+
+void scroll_update(Scroll *scroll, float contentHeight, float viewHeight) {
+    double now = GetTime();
+    float dt = now - scroll->lastTime;
+    if(dt > SCROLL_MAX_FRAME_TIME) dt = SCROLL_MAX_FRAME_TIME;
+    scroll->lastTime = now;
+
+    float maxY = contentHeight > viewHeight ? contentHeight - viewHeight : 0;
+    float prevY = scroll->y;
+
+    scroll->target -= GetMouseWheelMove() * SCROLL_WHEEL_STEP;
+
+    if(IsKeyPressed(KEY_PAGE_DOWN)) scroll->target += viewHeight * SCROLL_PAGE_FACTOR;
+    if(IsKeyPressed(KEY_PAGE_UP)) scroll->target -= viewHeight * SCROLL_PAGE_FACTOR;
+    if(IsKeyPressed(KEY_HOME)) scroll->target = 0;
+    if(IsKeyPressed(KEY_END)) scroll->target = maxY;
+
+    scroll->target = clamp_scroll(scroll->target, maxY);
+
+    // the arrows move the view directly, there's nothing to animate
+    float keyMove = 0;
+    if(IsKeyDown(KEY_DOWN)) keyMove += SCROLL_KEY_SPEED * dt;
+    if(IsKeyDown(KEY_UP)) keyMove -= SCROLL_KEY_SPEED * dt;
+
+    if(keyMove != 0) {
+        scroll->target = clamp_scroll(scroll->target + keyMove, maxY);
+        scroll->y = clamp_scroll(scroll->y + keyMove, maxY);
+    }
+
+    // the view gets closer to the target in every frame, independently of the frame rate
+    scroll->y += (scroll->target - scroll->y) * (1 - expf(-SCROLL_SMOOTHNESS * dt));
+    if(fabsf(scroll->target - scroll->y) < 0.5f) scroll->y = scroll->target;
+
+    // the document can get shorter
+    scroll->y = clamp_scroll(scroll->y, maxY);
+
+    if(scroll->y != prevY) redraw_invalidate();
+}
@@ -0,0 +1,19 @@
+#ifndef SCROLL_H
+#define SCROLL_H
+
+#include <stdbool.h>
+
+// vertical position of the view in the document
+typedef struct {
+    float y; // top of the view, it's what the camera shows
+    float target; // where y is moving to, jumps like page down are animated
+    double lastTime;
+} Scroll;
+
+// moves the view with the keyboard (arrows, page up/down, home/end) and the mouse
+// wheel, and invalidates the frame while the view is moving
+void scroll_update(Scroll *scroll, float contentHeight, float viewHeight);
+// true if there's input that can move the view, then the frame has to be updated
+bool scroll_has_input();
+
+#endif // SCROLL_H
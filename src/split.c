@@ -0,0 +1,196 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "split.h"
+
+#define MAX_FENCE_INDENT 3
+
+typedef struct {
+    const char *start;
+    size_t size;
+} Line;
+
+static bool is_blank(Line line) {
+    for(size_t i = 0; i < line.size; i++) {
+        char c = line.start[i];
+        if(c != ' ' && c != '\t' && c != '\r') return false;
+    }
+    return true;
+}
+
+static size_t count_indent(Line line) {
+    size_t i = 0;
+    while(i < line.size && line.start[i] == ' ') i++;
+    return i;
+}
+
+static bool is_list_marker(Line line) {
+    size_t i = 0;
+
+    if(line.size > 0 && (line.start[0] == '-' || line.start[0] == '*' || line.start[0] == '+')) {
+        i = 1;
+    } else {
+        // ordered lists allow up to 9 digits
+        while(i < line.size && i < 9 && line.start[i] >= '0' && line.start[i] <= '9') i++;
+
+        if(i == 0 || i >= line.size || (line.start[i] != '.' && line.start[i] != ')')) {
+            return false;
+        }
+        i++;
+    }
+
+    return i == line.size || line.start[i] == ' ' || line.start[i] == '\t' || line.start[i] == '\r';
+}
+
+// returns the length of the fence or 0 if the line isn't a fence
+static size_t fence_length(Line line, char *fenceChar) {
+    size_t indent = count_indent(line);
+    if(indent > MAX_FENCE_INDENT || indent >= line.size) return 0;
+
+    char c = line.start[indent];
+    if(c != '`' && c != '~') return 0;
+
+    size_t i = indent;
+    while(i < line.size && line.start[i] == c) i++;
+
+    size_t length = i - indent;
+    if(length < 3) return 0;
+
+    // the info string of a backtick fence can't have backticks, the line is a paragraph
+    // with a code span then
+    if(c == '`' && memchr(line.start + i, '`', line.size - i) != NULL) return 0;
+
+    *fenceChar = c;
+    return length;
+}
+
+static bool is_fence_closer(Line line, char fenceChar, size_t fenceLength) {
+    char c;
+    size_t length = fence_length(line, &c);
+    if(length == 0 || c != fenceChar || length < fenceLength) return false;
+
+    // only whitespace can follow a closing fence
+    Line rest = { line.start + count_indent(line) + length, 0 };
+    rest.size = line.start + line.size - rest.start;
+    return is_blank(rest);
+}
+
+size_t split_next_boundary(const char *text, size_t size, size_t from) {
+    bool prevBlank = false;
+
+    char fenceChar = 0;
+    size_t fenceLength = 0; // 0 when we are not inside a fenced code block
+
+    size_t pos = from;
+    while(pos < size) {
+        const char *end = memchr(text + pos, '\n', size - pos);
+        size_t lineEnd = end == NULL ? size : (size_t)(end - text);
+        Line line = { text + pos, lineEnd - pos };
+
+        bool blank = is_blank(line);
+
+        if(fenceLength > 0) {
+            if(is_fence_closer(line, fenceChar, fenceLength)) fenceLength = 0;
+        } else {
+            bool boundary = pos > from && prevBlank && !blank
+                && line.start[0] != ' ' && line.start[0] != '\t'
+                && !is_list_marker(line);
+
+            if(boundary) return pos;
+
+            fenceLength = fence_length(line, &fenceChar);
+        }
+
+        prevBlank = blank;
+        pos = lineEnd + 1;
+    }
+
+    return size;
+}
+
+static bool may_be_ref_def(Line line) {
+    size_t indent = count_indent(line);
+    if(indent > 3 || indent >= line.size || line.start[indent] != '[') return false;
+
+    // this can give false positives, but it only makes the callers more careful
+    const char *close = memchr(line.start, ']', line.size);
+    return close != NULL && close + 1 < line.start + line.size && close[1] == ':';
+}
+
+bool split_has_ref_defs(const char *text, size_t size) {
+    size_t pos = 0;
+    while(pos < size) {
+        const char *end = memchr(text + pos, '\n', size - pos);
+        size_t lineEnd = end == NULL ? size : (size_t)(end - text);
+        Line line = { text + pos, lineEnd - pos };
+
+        if(may_be_ref_def(line)) return true;
+
+        pos = lineEnd + 1;
+    }
+
+    return false;
+}
+
+static void append_line(char **out, size_t *size, size_t *capacity, Line line) {
+    if(*size + line.size + 1 > *capacity) {
+        while(*size + line.size + 1 > *capacity) *capacity *= 2;
+        *out = realloc(*out, *capacity);
+    }
+
+    memcpy(*out + *size, line.start, line.size);
+    *size += line.size;
+    (*out)[(*size)++] = '\n';
+}
+
+char *split_gather_ref_defs(const char *text, size_t size, size_t *outSize) {
+    size_t capacity = 4096;
+    char *out = malloc(capacity);
+    *outSize = 0;
+
+    bool prevBlank = true;
+    bool inGroup = false; // the previous lines were gathered
+
+    char fenceChar = 0;
+    size_t fenceLength = 0;
+
+    size_t pos = 0;
+    while(pos < size) {
+        const char *end = memchr(text + pos, '\n', size - pos);
+        size_t lineEnd = end == NULL ? size : (size_t)(end - text);
+        Line line = { text + pos, lineEnd - pos };
+
+        bool blank = is_blank(line);
+
+        if(fenceLength > 0) {
+            if(is_fence_closer(line, fenceChar, fenceLength)) fenceLength = 0;
+        } else if(inGroup && !blank) {
+            // a definition can continue in the next lines (e.g. its title)
+            append_line(&out, outSize, &capacity, line);
+        } else if(may_be_ref_def(line)) {
+            // a definition can't interrupt a paragraph, so the line would be
+            // a paragraph for the whole text but a definition on its own
+            if(!prevBlank) {
+                free(out);
+                return NULL;
+            }
+
+            append_line(&out, outSize, &capacity, line);
+            inGroup = true;
+        } else {
+            fenceLength = fence_length(line, &fenceChar);
+        }
+
+        if(blank && inGroup) {
+            append_line(&out, outSize, &capacity, line);
+            inGroup = false;
+        }
+
+        prevBlank = blank;
+        pos = lineEnd + 1;
+    }
+
+    if(inGroup) append_line(&out, outSize, &capacity, (Line){ "", 0 });
+
+    return out;
+}
@@ -0,0 +1,25 @@
+#ifndef SPLIT_H
+#define SPLIT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// A safe boundary is the start of a line where a new top-level block begins no matter
+// what comes before it: the previous line is blank, the line isn't indented, it isn't
+// a list marker (it could continue a loose list) and it's outside of a fenced code block.
+// Parsing the text between two safe boundaries on its own gives the same blocks as
+// parsing the whole text, except for link reference definitions that are global.
+
+// returns the first safe boundary after from, or size if there's none
+// from has to be 0 or a safe boundary
+size_t split_next_boundary(const char *text, size_t size, size_t from);
+
+// true if the text may contain link reference definitions
+bool split_has_ref_defs(const char *text, size_t size);
+// copies the lines that may be link reference definitions, and the lines after them
+// until a blank line, so they can be put before every part of a split text
+// returns NULL if a line that looks like a definition can't be gathered safely
+// the result has to be checked, it may not be only definitions (see parser.c)
+char *split_gather_ref_defs(const char *text, size_t size, size_t *outSize);
+
+#endif // SPLIT_H
@@ -0,0 +1,95 @@
+#include <stdatomic.h>
+#include <time.h>
+
+#include "stats.h"
+
+static const char *phaseNames[STATS_PHASE_COUNT] = {
+    [STATS_LAYOUT] = "layout",
+    [STATS_MEASURE] = "measure",
+    [STATS_CULL] = "culling",
+    [STATS_DRAW] = "draw",
+    [STATS_PRESENT] = "present",
+};
+
+static const char *counterNames[STATS_COUNTER_COUNT] = {
+    [STATS_WORDS_MEASURED] = "words measured",
+    [STATS_DRAW_CALLS] = "draw calls",
+    [STATS_GLYPHS] = "glyphs",
+    [STATS_NODES_VISITED] = "nodes visited",
+    [STATS_NODES_PARSED] = "nodes parsed",
+    [STATS_ARENA_BYTES] = "arena bytes",
+};
+
+// the current frame, written by every thread
+static atomic_int_fast64_t phases[STATS_PHASE_COUNT];
+static atomic_int_fast64_t counters[STATS_COUNTER_COUNT];
+static int64_t frameStart;
+
+// only touched by the thread that draws the frames
+static StatsFrame history[STATS_HISTORY];
+static size_t historyCount;
+static size_t historyNext;
+
+int64_t stats_now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+void stats_frame_begin() {
+    frameStart = stats_now();
+}
+
+void stats_frame_end() {
+    StatsFrame *frame = &history[historyNext];
+    frame->frameMs = (stats_now() - frameStart) / 1e6;
+
+    // the work done between frames (e.g. a layout started by a resize) goes to the next one
+    for(StatsPhase i = 0; i < STATS_PHASE_COUNT; i++) {
+        frame->phaseMs[i] = atomic_exchange_explicit(&phases[i], 0, memory_order_relaxed) / 1e6;
+    }
+
+    for(StatsCounter i = 0; i < STATS_COUNTER_COUNT; i++) {
+        if(i < STATS_FIRST_TOTAL) {
+            frame->counters[i] = atomic_exchange_explicit(&counters[i], 0, memory_order_relaxed);
+        } else {
+            frame->counters[i] = atomic_load_explicit(&counters[i], memory_order_relaxed);
+        }
+    }
+
+    historyNext = (historyNext + 1) % STATS_HISTORY;
+    if(historyCount < STATS_HISTORY) historyCount++;
+}
+
+void stats_add_time(StatsPhase phase, int64_t nanoseconds) {
+    atomic_fetch_add_explicit(&phases[phase], nanoseconds, memory_order_relaxed);
+}
+
+void stats_add(StatsCounter counter, int64_t value) {
+    atomic_fetch_add_explicit(&counters[counter], value, memory_order_relaxed);
+}
+
+StatsFrame stats_last_frame() {
+    if(historyCount == 0) return (StatsFrame){0};
+
+    return history[(historyNext + STATS_HISTORY - 1) % STATS_HISTORY];
+}
+
+size_t stats_history(StatsFrame *frames, size_t max) {
+    size_t count = historyCount < max ? historyCount : max;
+    size_t first = (historyNext + STATS_HISTORY - count) % STATS_HISTORY;
+
+    for(size_t i = 0; i < count; i++) {
+        frames[i] = history[(first + i) % STATS_HISTORY];
+    }
+
+    return count;
+}
+
+const char *stats_phase_name(StatsPhase phase) {
+    return phaseNames[phase];
+}
+
+const char *stats_counter_name(StatsCounter counter) {
+    return counterNames[counter];
+}
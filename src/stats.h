@@ -0,0 +1,63 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Timings and counters of the frames, for the profiler overlay (see overlay.h). The
+// instrumentation points only do a relaxed atomic add, so they can be called from any
+// thread and they are always on.
+
+#define STATS_HISTORY 240 // frames kept for the graph
+
+typedef enum {
+    STATS_LAYOUT, // laying out the view, it includes STATS_MEASURE
+    STATS_MEASURE, // shaping the blocks, summed over the layout threads
+    STATS_CULL, // finding the visible blocks and tiles
+    STATS_DRAW, // sending the items and the tiles to the GPU
+    STATS_PRESENT, // EndDrawing, it includes the wait for the vsync
+    STATS_PHASE_COUNT,
+} StatsPhase;
+
+typedef enum {
+    // counted for every frame
+    STATS_WORDS_MEASURED,
+    STATS_DRAW_CALLS,
+    STATS_GLYPHS,
+    STATS_NODES_VISITED, // by the layout, when it shapes or estimates the blocks
+
+    // totals since the start
+    STATS_NODES_PARSED,
+    STATS_ARENA_BYTES, // reserved by the arenas that are alive
+
+    STATS_COUNTER_COUNT,
+} StatsCounter;
+
+// the counters before this one start from 0 every frame
+#define STATS_FIRST_TOTAL STATS_NODES_PARSED
+
+typedef struct {
+    double frameMs; // from stats_frame_begin to stats_frame_end
+    double phaseMs[STATS_PHASE_COUNT];
+    int64_t counters[STATS_COUNTER_COUNT];
+} StatsFrame;
+
+// monotonic time in nanoseconds
+int64_t stats_now();
+
+void stats_frame_begin();
+// saves the frame in the history and starts the per-frame counters again
+void stats_frame_end();
+
+void stats_add_time(StatsPhase phase, int64_t nanoseconds);
+void stats_add(StatsCounter counter, int64_t value);
+
+// the last finished frame
+StatsFrame stats_last_frame();
+// copies up to max frames of the history, the oldest first, returns how many
+size_t stats_history(StatsFrame *frames, size_t max);
+
+const char *stats_phase_name(StatsPhase phase);
+const char *stats_counter_name(StatsCounter counter);
+
+#endif // STATS_H
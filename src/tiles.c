@@ -0,0 +1,68 @@
+#include <string.h>
+
+#include "tiles.h"
+
+static void unload_tiles(TileCache *cache) {
+    for(size_t i = 0; i < TILE_CACHE_SIZE; i++) {
+        Tile *tile = &cache->tiles[i];
+        if(tile->loaded) UnloadRenderTexture(tile->target);
+
+        tile->loaded = false;
+        tile->index = -1;
+    }
+}
+
+void tile_cache_begin(TileCache *cache, int width, float changedY) {
+    cache->frame++;
+
+    // the cache starts with width 0, so the tiles are also cleared the first time
+    if(width != cache->width) {
+        unload_tiles(cache);
+        cache->width = width;
+        return;
+    }
+
+    for(size_t i = 0; i < TILE_CACHE_SIZE; i++) {
+        Tile *tile = &cache->tiles[i];
+        if(tile->index >= 0 && (tile->index + 1) * TILE_HEIGHT > changedY) tile->index = -1;
+    }
+}
+
+Tile *tile_cache_get(TileCache *cache, int64_t index, bool *fresh) {
+    Tile *oldest = NULL;
+
+    for(size_t i = 0; i < TILE_CACHE_SIZE; i++) {
+        Tile *tile = &cache->tiles[i];
+
+        if(tile->index == index) {
+            tile->lastUsed = cache->frame;
+            *fresh = false;
+            return tile;
+        }
+
+        // a tile used in this frame is already on the screen
+        if(tile->lastUsed == cache->frame) continue;
+
+        if(oldest == NULL || tile->index < 0
+            || (oldest->index >= 0 && tile->lastUsed < oldest->lastUsed)) {
+            oldest = tile;
+        }
+    }
+
+    if(oldest == NULL || cache->width <= 0) return NULL;
+
+    if(!oldest->loaded) {
+        oldest->target = LoadRenderTexture(cache->width, TILE_HEIGHT);
+        oldest->loaded = true;
+    }
+
+    oldest->index = index;
+    oldest->lastUsed = cache->frame;
+    *fresh = true;
+    return oldest;
+}
+
+void tile_cache_free(TileCache *cache) {
+    unload_tiles(cache);
+    memset(cache, 0, sizeof(TileCache));
+}
@@ -0,0 +1,36 @@
+#ifndef TILES_H
+#define TILES_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "raylib.h"
+
+// the document is drawn in horizontal strips of the window's width, so scrolling
+// only has to copy the strips already drawn and draw the ones that appear
+#define TILE_HEIGHT 256
+// enough tiles to cover a tall window plus some that were visible not long ago
+#define TILE_CACHE_SIZE 16
+
+typedef struct {
+    int64_t index; // the tile covers [index * TILE_HEIGHT, (index + 1) * TILE_HEIGHT), -1 if it's free
+    uint64_t lastUsed; // frame when the tile was drawn on the screen for the last time
+    RenderTexture2D target;
+    bool loaded;
+} Tile;
+
+typedef struct {
+    Tile tiles[TILE_CACHE_SIZE];
+    int width; // width of the loaded render textures
+    uint64_t frame;
+} TileCache;
+
+// starts a new frame, the tiles drawn with another width or that cover something
+// below changedY are dropped
+void tile_cache_begin(TileCache *cache, int width, float changedY);
+// returns the tile for index, if fresh is set its content has to be drawn again
+// returns NULL if every tile is already being used in this frame
+Tile *tile_cache_get(TileCache *cache, int64_t index, bool *fresh);
+void tile_cache_free(TileCache *cache);
+
+#endif // TILES_H
@@ -0,0 +1,285 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "raylib.h"
+#include "stats.h"
+#include "trace.h"
+
+#define TRACE_MAX_THREADS 256
+
+typedef struct {
+    const char *category;
+    const char *name;
+    int64_t start, duration; // nanoseconds
+    const char *argName; // NULL if there's no argument
+    int64_t arg;
+} TraceEvent;
+
+// ring buffer with the thread as the only producer and the writer as the only consumer
+typedef struct {
+    TraceEvent events[TRACE_BUFFER_SIZE];
+    atomic_size_t head; // next event to write to the file, only written by the writer
+    atomic_size_t tail; // next free slot, only written by the thread
+    atomic_size_t dropped; // only written by the thread
+
+    int id;
+    const char *name;
+    atomic_bool named; // the name wasn't written yet
+
+    // the thread and the trace own the buffer, the last one to let it go frees it
+    atomic_int owners;
+} TraceBuffer;
+
+static struct {
+    atomic_bool enabled;
+    FILE *file;
+    bool firstEvent;
+    int64_t origin; // the timestamps start from here
+
+    pthread_mutex_t mutex; // for the list of buffers and to stop the writer
+    pthread_cond_t stopped;
+    bool stop;
+    pthread_t writer;
+
+    // a buffer is removed from the list once its thread exited and its events were written
+    TraceBuffer *buffers[TRACE_MAX_THREADS];
+    int count;
+    int nextId;
+    size_t dropped; // events dropped by the buffers that were freed, only used by the writer
+
+    // its destructor lets go of the buffer of a thread that exits
+    pthread_key_t key;
+} trace = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .stopped = PTHREAD_COND_INITIALIZER,
+};
+
+static _Thread_local TraceBuffer *localBuffer;
+
+static void release_buffer(void *data) {
+    TraceBuffer *buffer = data;
+    if(atomic_fetch_sub(&buffer->owners, 1) == 1) free(buffer);
+}
+
+static TraceBuffer *get_buffer() {
+    if(localBuffer != NULL) return localBuffer;
+
+    pthread_mutex_lock(&trace.mutex);
+
+    if(trace.count < TRACE_MAX_THREADS) {
+        localBuffer = calloc(1, sizeof(TraceBuffer));
+        localBuffer->id = ++trace.nextId;
+        atomic_init(&localBuffer->owners, 2);
+        trace.buffers[trace.count++] = localBuffer;
+        pthread_setspecific(trace.key, localBuffer);
+    }
+
+    pthread_mutex_unlock(&trace.mutex);
+    return localBuffer;
+}
+
+static void write_event(TraceBuffer *buffer, TraceEvent *event) {
+    fprintf(
+        trace.file,
+        "%s\n{\"cat\":\"%s\",\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+        trace.firstEvent ? "" : ",",
+        event->category, event->name, buffer->id,
+        (event->start - trace.origin) / 1000.0, event->duration / 1000.0
+    );
+
+    if(event->argName != NULL) {
+        fprintf(trace.file, ",\"args\":{\"%s\":%lld}", event->argName, (long long)event->arg);
+    }
+
+    fputc('}', trace.file);
+    trace.firstEvent = false;
+}
+
+// moves the events of every buffer to the file
+static void flush_buffers() {
+    pthread_mutex_lock(&trace.mutex);
+    int count = trace.count;
+    pthread_mutex_unlock(&trace.mutex);
+
+    for(int i = 0; i < count; i++) {
+        TraceBuffer *buffer = trace.buffers[i];
+        // checked before reading the buffer, so the last events of the thread are written
+        bool exited = atomic_load(&buffer->owners) == 1;
+
+        if(atomic_exchange(&buffer->named, false)) {
+            fprintf(
+                trace.file,
+                "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                trace.firstEvent ? "" : ",", buffer->id, buffer->name
+            );
+            trace.firstEvent = false;
+        }
+
+        size_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+        size_t tail = atomic_load_explicit(&buffer->tail, memory_order_acquire);
+
+        for(; head != tail; head++) {
+            write_event(buffer, &buffer->events[head & (TRACE_BUFFER_SIZE - 1)]);
+        }
+
+        atomic_store_explicit(&buffer->head, head, memory_order_release);
+
+        // nothing can be added to the buffer of a thread that exited
+        if(exited) {
+            trace.dropped += atomic_load(&buffer->dropped);
+            free(buffer);
+            trace.buffers[i] = NULL;
+        }
+    }
+
+    // the buffers added meanwhile are after count, so they stay in order
+    pthread_mutex_lock(&trace.mutex);
+
+    int kept = 0;
+    for(int i = 0; i < trace.count; i++) {
+        if(trace.buffers[i] != NULL) trace.buffers[kept++] = trace.buffers[i];
+    }
+    trace.count = kept;
+
+    pthread_mutex_unlock(&trace.mutex);
+}
+
+static void *trace_writer(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&trace.mutex);
+
+    while(!trace.stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += TRACE_FLUSH_INTERVAL_MS * 1000000L;
+        if(deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        int result = pthread_cond_timedwait(&trace.stopped, &trace.mutex, &deadline);
+        if(result != 0 && result != ETIMEDOUT) break;
+
+        pthread_mutex_unlock(&trace.mutex);
+        flush_buffers();
+        pthread_mutex_lock(&trace.mutex);
+    }
+
+    pthread_mutex_unlock(&trace.mutex);
+    return NULL;
+}
+
+bool trace_start(const char *filePath) {
+    trace.file = fopen(filePath, "w");
+    if(trace.file == NULL) {
+        TraceLog(LOG_ERROR, "TRACE: [%s] Couldn't create the file", filePath);
+        return false;
+    }
+
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", trace.file);
+    trace.firstEvent = true;
+    trace.origin = stats_now();
+
+    if(pthread_key_create(&trace.key, release_buffer) != 0) {
+        fclose(trace.file);
+        trace.file = NULL;
+        return false;
+    }
+
+    if(pthread_create(&trace.writer, NULL, trace_writer, NULL) != 0) {
+        pthread_key_delete(trace.key);
+        fclose(trace.file);
+        trace.file = NULL;
+        return false;
+    }
+
+    atomic_store(&trace.enabled, true);
+    return true;
+}
+
+void trace_stop() {
+    if(trace.file == NULL) return;
+
+    atomic_store(&trace.enabled, false);
+
+    pthread_mutex_lock(&trace.mutex);
+    trace.stop = true;
+    pthread_cond_signal(&trace.stopped);
+    pthread_mutex_unlock(&trace.mutex);
+    pthread_join(trace.writer, NULL);
+
+    // the calling thread doesn't record anything else, and the destructor of the key
+    // doesn't run for the main thread
+    if(localBuffer != NULL) {
+        pthread_setspecific(trace.key, NULL);
+        release_buffer(localBuffer);
+        localBuffer = NULL;
+    }
+
+    // the events recorded after the last flush
+    flush_buffers();
+
+    // the threads that are still running free their buffers when they exit
+    size_t dropped = trace.dropped;
+    for(int i = 0; i < trace.count; i++) {
+        dropped += atomic_load(&trace.buffers[i]->dropped);
+        release_buffer(trace.buffers[i]);
+    }
+    trace.count = 0;
+
+    if(dropped > 0) TraceLog(LOG_WARNING, "TRACE: %zu events were dropped, the buffers were full", dropped);
+
+    fputs("\n]}\n", trace.file);
+    fclose(trace.file);
+    trace.file = NULL;
+}
+
+bool trace_enabled() {
+    return atomic_load_explicit(&trace.enabled, memory_order_relaxed);
+}
+
+void trace_thread_name(const char *name) {
+    if(!trace_enabled()) return;
+
+    TraceBuffer *buffer = get_buffer();
+    if(buffer == NULL) return;
+
+    buffer->name = name;
+    atomic_store(&buffer->named, true);
+}
+
+void trace_event_arg(const char *category, const char *name, int64_t start, const char *argName, int64_t arg) {
+    if(!trace_enabled()) return;
+
+    TraceBuffer *buffer = get_buffer();
+    if(buffer == NULL) return;
+
+    size_t tail = atomic_load_explicit(&buffer->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+
+    if(tail - head == TRACE_BUFFER_SIZE) {
+        atomic_fetch_add_explicit(&buffer->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    buffer->events[tail & (TRACE_BUFFER_SIZE - 1)] = (TraceEvent){
+        .category = category,
+        .name = name,
+        .start = start,
+        .duration = stats_now() - start,
+        .argName = argName,
+        .arg = arg,
+    };
+
+    atomic_store_explicit(&buffer->tail, tail + 1, memory_order_release);
+}
+
+void trace_event(const char *category, const char *name, int64_t start) {
+    trace_event_arg(category, name, start, NULL, 0);
+}
@@ -0,0 +1,30 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Records what the threads were doing as Chrome trace events, the file can be opened
+// with chrome://tracing or https://ui.perfetto.dev. Every thread writes its events into
+// its own ring buffer, and a background thread moves them to the file, so recording an
+// event never waits for the disk. The events of a full buffer are dropped. The buffer of
+// a thread is freed once the thread exited and its events were written.
+
+#define TRACE_BUFFER_SIZE 16384 // events per thread, has to be a power of two
+#define TRACE_FLUSH_INTERVAL_MS 20
+
+// it can only be started once, returns false if the file can't be created
+bool trace_start(const char *filePath);
+// writes the remaining events and closes the file
+void trace_stop();
+bool trace_enabled();
+
+// name of the calling thread in the trace
+void trace_thread_name(const char *name);
+
+// records an event from start (see stats_now) until now, the names have to be literals
+void trace_event(const char *category, const char *name, int64_t start);
+// same as trace_event with an argument, like the index of a block
+void trace_event_arg(const char *category, const char *name, int64_t start, const char *argName, int64_t arg);
+
+#endif // TRACE_H
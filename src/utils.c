@@ -1,23 +1,30 @@
 #include <string.h>
 #include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <unistd.h>
 
+#include "raylib.h"
+#include "stats.h"
+#include "trace.h"
 #include "utils.h"
 
-static ArenaRegion *alloc_region() {
+static ArenaRegion *alloc_region(size_t capacity) {
     ArenaRegion *region = malloc(sizeof(ArenaRegion));
-    region->data = malloc(ARENA_REGION_SIZE);
+    region->data = malloc(capacity);
     region->count = 0;
-    region->capacity = ARENA_REGION_SIZE;
+    region->capacity = capacity;
     region->next = NULL;
 
+    stats_add(STATS_ARENA_BYTES, capacity);
     return region;
 }
 
 Arena *arena_create() {
     Arena *arena = malloc(sizeof(Arena));
-    arena->head = arena->tail = alloc_region();
+    arena->head = arena->tail = arena->last = alloc_region(ARENA_REGION_SIZE);
     arena->count = 1;
+    arena->nextCapacity = ARENA_REGION_SIZE * 2;
     return arena;
 }
 
@@ -25,6 +32,7 @@ void arena_free(Arena *arena) {
     ArenaRegion *region = arena->head;
 
     while(region != NULL) {
+        stats_add(STATS_ARENA_BYTES, -(int64_t)region->capacity);
         free(region->data);
         ArenaRegion *oldRegion = region;
         region = region->next;
@@ -34,29 +42,172 @@ void arena_free(Arena *arena) {
     free(arena);
 }
 
-static ArenaRegion *arena_add_new_region(Arena *arena) {
-    ArenaRegion *region = alloc_region();
+void arena_merge(Arena *arena, Arena *other) {
+    // the regions of other go before the tail, so the tail is still where new
+    // allocations go first
+    ArenaRegion *prev = NULL;
+    for(ArenaRegion *it = arena->head; it != arena->tail; it = it->next) prev = it;
+
+    if(prev == NULL) {
+        arena->head = other->head;
+    } else {
+        prev->next = other->head;
+    }
+    other->tail->next = arena->tail;
+
+    arena->count += other->count;
+    free(other);
+}
+
+ArenaStats arena_stats(Arena *arena) {
+    ArenaStats stats = {0};
+
+    for(ArenaRegion *region = arena->head; region != NULL; region = region->next) {
+        stats.used += region->count;
+        stats.reserved += region->capacity;
+        stats.regions++;
+    }
+
+    return stats;
+}
+
+// offset of the next allocation in the region with that alignment
+static size_t region_aligned_offset(ArenaRegion *region, size_t alignment) {
+    uintptr_t address = (uintptr_t)region->data + region->count;
+    uintptr_t aligned = (address + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    return region->count + (aligned - address);
+}
+
+static bool region_fits(ArenaRegion *region, size_t bytes, size_t alignment) {
+    return region_aligned_offset(region, alignment) + bytes <= region->capacity;
+}
+
+static ArenaRegion *arena_add_new_region(Arena *arena, size_t bytes, size_t alignment) {
+    // the data of a region is aligned by malloc, but bigger alignments may need padding
+    size_t needed = bytes + alignment - 1;
+
+    if(needed > arena->nextCapacity / 2) {
+        // big allocations get their own region, it goes before the tail so the
+        // free space of the tail can still be used
+        ArenaRegion *region = alloc_region(needed);
+
+        ArenaRegion *prev = NULL;
+        for(ArenaRegion *it = arena->head; it != arena->tail; it = it->next) prev = it;
+
+        region->next = arena->tail;
+        if(prev == NULL) {
+            arena->head = region;
+        } else {
+            prev->next = region;
+        }
+
+        arena->count++;
+        return region;
+    }
+
+    // the regions grow geometrically so big documents don't need a lot of them
+    ArenaRegion *region = alloc_region(arena->nextCapacity);
+    if(arena->nextCapacity < ARENA_MAX_REGION_SIZE) arena->nextCapacity *= 2;
+
     arena->tail->next = region;
     arena->tail = region;
+    arena->count++;
     return region;
 }
 
-void *arena_alloc(Arena *arena, size_t bytes) {
-    assert(bytes <= ARENA_REGION_SIZE && "That's too much memory you are asking for :(");
+// first region with enough free space for bytes
+static ArenaRegion *arena_find_region(Arena *arena, size_t bytes, size_t alignment) {
+    if(region_fits(arena->tail, bytes, alignment)) return arena->tail;
 
-    ArenaRegion *region = arena->tail;
+    // the space left at the end of the older regions can still be used
+    for(ArenaRegion *region = arena->head; region != arena->tail; region = region->next) {
+        if(region_fits(region, bytes, alignment)) return region;
+    }
+
+    return NULL;
+}
 
-    // if the region is full we create a new one
-    if(region->count + bytes > region->capacity) {
-        region = arena_add_new_region(arena);
+void *arena_alloc_uninit(Arena *arena, size_t bytes, size_t alignment) {
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0 && "The alignment has to be a power of two");
+
+    ArenaRegion *region = arena_find_region(arena, bytes, alignment);
+
+    if(region == NULL) {
+        region = arena_add_new_region(arena, bytes, alignment);
+    }
+
+    size_t offset = region_aligned_offset(region, alignment);
+    region->count = offset + bytes;
+    arena->last = region;
+    return (char *)region->data + offset;
+}
+
+static bool region_ends_with(ArenaRegion *region, void *ptr, size_t size) {
+    return (char *)ptr + size == (char *)region->data + region->count;
+}
+
+// region where the memory is the last allocation, NULL if there's none
+static ArenaRegion *arena_find_last(Arena *arena, void *ptr, size_t size, bool search) {
+    if(region_ends_with(arena->last, ptr, size)) return arena->last;
+    if(!search) return NULL;
+
+    for(ArenaRegion *region = arena->head; region != NULL; region = region->next) {
+        if(region_ends_with(region, ptr, size)) return region;
+    }
+
+    return NULL;
+}
+
+void *arena_realloc(Arena *arena, void *ptr, size_t oldSize, size_t newSize) {
+    if(ptr == NULL) return arena_alloc_uninit(arena, newSize, ARENA_DEFAULT_ALIGNMENT);
+
+    // a block this big would be copied, so it's worth walking the regions to find out
+    // if it's alone in its own region
+    bool big = newSize + ARENA_DEFAULT_ALIGNMENT - 1 > arena->nextCapacity / 2;
+
+    ArenaRegion *region = arena_find_last(arena, ptr, oldSize, big);
+    size_t offset = region != NULL ? (size_t)((char *)ptr - (char *)region->data) : 0;
+
+    if(region != NULL) {
+        if(offset + newSize <= region->capacity) {
+            region->count = offset + newSize;
+            return ptr;
+        }
+
+        // nothing else is in the region, so it grows with the block, realloc may not
+        // need to copy it
+        if(offset == 0) {
+            stats_add(STATS_ARENA_BYTES, (int64_t)newSize - (int64_t)region->capacity);
+            region->data = realloc(region->data, newSize);
+            region->capacity = newSize;
+            region->count = newSize;
+            return region->data;
+        }
     }
 
-    void *mem = region->data + region->count;
-    bzero(mem, bytes);
-    region->count += bytes;
+    void *mem = arena_alloc_uninit(arena, newSize, ARENA_DEFAULT_ALIGNMENT);
+    memcpy(mem, ptr, oldSize < newSize ? oldSize : newSize);
+
+    // the new block can't be in the same region, it didn't fit there
+    if(region != NULL) region->count = offset;
     return mem;
 }
 
+void arena_release(Arena *arena, void *ptr, size_t size) {
+    ArenaRegion *region = arena_find_last(arena, ptr, size, false);
+    if(region != NULL) region->count = (char *)ptr - (char *)region->data;
+}
+
+void *arena_alloc_aligned(Arena *arena, size_t bytes, size_t alignment) {
+    void *mem = arena_alloc_uninit(arena, bytes, alignment);
+    memset(mem, 0, bytes);
+    return mem;
+}
+
+void *arena_alloc(Arena *arena, size_t bytes) {
+    return arena_alloc_aligned(arena, bytes, ARENA_DEFAULT_ALIGNMENT);
+}
+
 void stack_push(Stack *stack, void *item) {
     assert(stack->count < MAX_STACK_SIZE && "Max stack size reached");
     stack->items[stack->count] = item;
@@ -72,3 +223,147 @@ void *stack_get_last(Stack *stack) {
     if(stack->count == 0) return NULL;
     return stack->items[stack->count - 1];
 }
+
+bool spsc_queue_push(SPSCQueue *queue, void *item) {
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&queue->head, memory_order_acquire);
+
+    if(tail - head == SPSC_QUEUE_SIZE) return false;
+
+    queue->items[tail & (SPSC_QUEUE_SIZE - 1)] = item;
+    // the release makes everything written before the push visible to the consumer
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+void *spsc_queue_pop(SPSCQueue *queue) {
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_acquire);
+
+    if(head == tail) return NULL;
+
+    void *item = queue->items[head & (SPSC_QUEUE_SIZE - 1)];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return item;
+}
+
+int utf8_next_codepoint(const char *str, size_t size, size_t *bytes) {
+    const unsigned char *text = (const unsigned char *)str;
+    unsigned char c = text[0];
+    *bytes = 1;
+
+    if(c < 0x80) return c;
+
+    int length = (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+    if(length == 0 || (size_t)length > size) return '?';
+
+    int codepoint = c & (0xFF >> (length + 1));
+    for(int i = 1; i < length; i++) {
+        if((text[i] & 0xC0) != 0x80) return '?';
+        codepoint = (codepoint << 6) | (text[i] & 0x3F);
+    }
+
+    *bytes = length;
+    return codepoint;
+}
+
+static void thread_pool_work(ThreadPool *pool, size_t worker) {
+    size_t index;
+    while((index = atomic_fetch_add(&pool->next, 1)) < pool->count) {
+        pool->task(pool->data, index, worker);
+    }
+}
+
+static void *thread_pool_worker(void *arg) {
+    ThreadPoolWorker *worker = arg;
+    ThreadPool *pool = worker->pool;
+    uint64_t generation = 0;
+
+    trace_thread_name("pool worker");
+
+    pthread_mutex_lock(&pool->mutex);
+
+    while(true) {
+        while(!pool->stop && pool->generation == generation) {
+            pthread_cond_wait(&pool->started, &pool->mutex);
+        }
+
+        if(pool->stop) break;
+        generation = pool->generation;
+
+        pthread_mutex_unlock(&pool->mutex);
+        thread_pool_work(pool, worker->index);
+        pthread_mutex_lock(&pool->mutex);
+
+        pool->running--;
+        if(pool->running == 0) pthread_cond_signal(&pool->finished);
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+void thread_pool_init(ThreadPool *pool, size_t threadCount) {
+    memset(pool, 0, sizeof(ThreadPool));
+
+    if(threadCount == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = cpus > 0 ? (size_t)cpus : 1;
+    }
+    if(threadCount > THREAD_POOL_MAX_THREADS) threadCount = THREAD_POOL_MAX_THREADS;
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->started, NULL);
+    pthread_cond_init(&pool->finished, NULL);
+
+    // the calling thread is the worker 0
+    pool->workers[0].pool = pool;
+    pool->threadCount = 1;
+
+    for(size_t i = 1; i < threadCount; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+
+        // the pool works with the threads that could start, thread_pool_run waits for
+        // threadCount - 1 of them and thread_pool_free joins them
+        if(pthread_create(&pool->workers[i].thread, NULL, thread_pool_worker, &pool->workers[i]) != 0) {
+            TraceLog(LOG_WARNING, "THREADS: Only %zu of %zu threads could start", i, threadCount);
+            break;
+        }
+
+        pool->threadCount++;
+    }
+}
+
+void thread_pool_run(ThreadPool *pool, ThreadPoolTask task, void *data, size_t count) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->task = task;
+    pool->data = data;
+    pool->count = count;
+    atomic_store(&pool->next, 0);
+    pool->running = pool->threadCount - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->started);
+    pthread_mutex_unlock(&pool->mutex);
+
+    thread_pool_work(pool, 0);
+
+    pthread_mutex_lock(&pool->mutex);
+    while(pool->running > 0) pthread_cond_wait(&pool->finished, &pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void thread_pool_free(ThreadPool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->started);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for(size_t i = 1; i < pool->threadCount; i++) {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->started);
+    pthread_cond_destroy(&pool->finished);
+}
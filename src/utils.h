@@ -1,8 +1,18 @@
 #ifndef UTILS_H
 #define UTILS_H
 
-#define ARENA_REGION_SIZE 4096
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define ARENA_REGION_SIZE 4096 // size of the first region
+#define ARENA_MAX_REGION_SIZE (1 << 20) // the regions stop growing at this size
+#define ARENA_DEFAULT_ALIGNMENT _Alignof(max_align_t) // same as malloc
 #define MAX_STACK_SIZE 100
+#define SPSC_QUEUE_SIZE 4096 // has to be a power of two
+#define THREAD_POOL_MAX_THREADS 64
 
 typedef struct ArenaRegion ArenaRegion;
 
@@ -15,22 +25,106 @@ struct ArenaRegion {
 };
 
 typedef struct {
-    ArenaRegion *head, *tail;
+    ArenaRegion *head, *tail; // the tail is the region where new allocations go first
+    ArenaRegion *last; // region of the last allocation, arena_realloc looks there first
     size_t count;
+    size_t nextCapacity;
 } Arena;
 
+typedef struct {
+    size_t used; // bytes given by the allocations, with their alignment padding
+    size_t reserved; // bytes of all the regions
+    size_t regions;
+} ArenaStats;
+
 
 typedef struct {
     void *items[MAX_STACK_SIZE];
     size_t count;
 } Stack;
 
+// lock-free queue with a single producer thread and a single consumer thread
+typedef struct {
+    void *items[SPSC_QUEUE_SIZE];
+    atomic_size_t head; // next item to pop, only written by the consumer
+    atomic_size_t tail; // next free slot, only written by the producer
+} SPSCQueue;
+
+// called once for every index of a task, worker goes from 0 to threadCount - 1 and
+// tells which thread is calling it, so the task can keep data per thread
+typedef void (*ThreadPoolTask)(void *data, size_t index, size_t worker);
+
+typedef struct ThreadPool ThreadPool;
+
+typedef struct {
+    ThreadPool *pool;
+    size_t index;
+    pthread_t thread;
+} ThreadPoolWorker;
+
+// fixed set of threads that run the indices of a task in parallel
+struct ThreadPool {
+    // the thread that runs a task also works on it as the worker 0
+    ThreadPoolWorker workers[THREAD_POOL_MAX_THREADS];
+    size_t threadCount;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t started;
+    pthread_cond_t finished;
+    uint64_t generation; // incremented every time a task starts
+    size_t running; // threads still working on the task
+    bool stop;
+
+    ThreadPoolTask task;
+    void *data;
+    size_t count;
+    atomic_size_t next; // next index to run
+};
+
 Arena *arena_create();
 void arena_free(Arena *arena);
+// moves the memory of other into arena and frees other, the pointers into it stay valid
+void arena_merge(Arena *arena, Arena *other);
+ArenaStats arena_stats(Arena *arena);
+// zeroed memory aligned like malloc
 void *arena_alloc(Arena *arena, size_t bytes);
+// zeroed memory, alignment has to be a power of two
+void *arena_alloc_aligned(Arena *arena, size_t bytes, size_t alignment);
+// same as arena_alloc_aligned but the memory isn't zeroed, for buffers that are
+// overwritten right away
+void *arena_alloc_uninit(Arena *arena, size_t bytes, size_t alignment);
+
+// grows the memory in place if it's the last allocation of its region and there's room,
+// or if it's alone in its region (like a big allocation), otherwise it's copied to a new
+// allocation, aligned like malloc
+// the new bytes aren't zeroed, the old memory can be used again if it was the last
+// allocation of its region, otherwise it's only released with the arena
+void *arena_realloc(Arena *arena, void *ptr, size_t oldSize, size_t newSize);
+// gives the memory back to its region if it's the last allocation of it, otherwise it's
+// only released with the arena
+void arena_release(Arena *arena, void *ptr, size_t size);
+
+#define arena_new(arena, T) ((T *)arena_alloc_aligned((arena), sizeof(T), _Alignof(T)))
+#define arena_new_array(arena, T, count) ((T *)arena_alloc_aligned((arena), sizeof(T) * (count), _Alignof(T)))
+#define arena_new_array_uninit(arena, T, count) ((T *)arena_alloc_uninit((arena), sizeof(T) * (count), _Alignof(T)))
 
 void stack_push(Stack *stack, void *item);
 void *stack_pop(Stack *stack);
 void *stack_get_last(Stack *stack);
 
+// decodes the UTF-8 codepoint at the start of text without reading past size, bytes
+// is set to its length, invalid sequences give '?' like raylib's GetCodepointNext
+int utf8_next_codepoint(const char *text, size_t size, size_t *bytes);
+
+// returns false if the queue is full
+bool spsc_queue_push(SPSCQueue *queue, void *item);
+// returns NULL if the queue is empty
+void *spsc_queue_pop(SPSCQueue *queue);
+
+// threadCount 0 uses one thread per CPU
+void thread_pool_init(ThreadPool *pool, size_t threadCount);
+// runs task for every index in [0, count) and waits until all of them finish
+void thread_pool_run(ThreadPool *pool, ThreadPoolTask task, void *data, size_t count);
+void thread_pool_free(ThreadPool *pool);
+
 #endif // UTILS_H
@@ -0,0 +1,123 @@
+#include <errno.h>
+#include <libgen.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "raylib.h"
+#include "watch.h"
+
+// the directory is watched instead of the file because a lot of editors save by
+// writing a new file and renaming it over the old one
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO)
+// the events are read by watch_poll on the other thread, the notify thread waits this
+// long before checking them again so it doesn't notify the same events in a loop
+#define WATCH_NOTIFY_INTERVAL_US 10000
+
+static void *watch_thread(void *arg) {
+    FileWatch *watch = arg;
+    struct pollfd fds[2] = {
+        { .fd = watch->fd, .events = POLLIN },
+        { .fd = watch->stopFd, .events = POLLIN },
+    };
+
+    while(true) {
+        if(poll(fds, 2, -1) == -1) {
+            if(errno == EINTR) continue;
+            break;
+        }
+
+        if(fds[1].revents != 0) break;
+
+        if(fds[0].revents & POLLIN) {
+            watch->notify();
+            usleep(WATCH_NOTIFY_INTERVAL_US);
+        }
+    }
+
+    return NULL;
+}
+
+bool watch_start(FileWatch *watch, const char *filePath, void (*notify)(void)) {
+    watch->notify = NULL;
+    watch->stopFd = -1;
+
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(watch->fd == -1) {
+        TraceLog(LOG_ERROR, "Couldn't initialize inotify (errno: %d)", errno);
+        return false;
+    }
+
+    // dirname and basename can modify their argument
+    char *dirPath = strdup(filePath);
+    char *namePath = strdup(filePath);
+
+    watch->wd = inotify_add_watch(watch->fd, dirname(dirPath), WATCH_EVENTS);
+    watch->fileName = strdup(basename(namePath));
+
+    free(dirPath);
+    free(namePath);
+
+    if(watch->wd == -1) {
+        TraceLog(LOG_ERROR, "Couldn't watch the file (errno: %d)", errno);
+        watch_stop(watch);
+        return false;
+    }
+
+    if(notify != NULL) {
+        watch->stopFd = eventfd(0, EFD_CLOEXEC);
+        watch->notify = notify;
+
+        if(watch->stopFd == -1 || pthread_create(&watch->thread, NULL, watch_thread, watch) != 0) {
+            TraceLog(LOG_ERROR, "Couldn't start the thread of the file watch");
+            watch->notify = NULL; // there's no thread to stop
+            watch_stop(watch);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool watch_poll(FileWatch *watch) {
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+
+    while(true) {
+        ssize_t size = read(watch->fd, events, sizeof(events));
+        if(size <= 0) break;
+
+        for(char *ptr = events; ptr < events + size;) {
+            struct inotify_event *event = (struct inotify_event *)ptr;
+
+            if(event->len > 0 && strcmp(event->name, watch->fileName) == 0) {
+                changed = true;
+            }
+
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    return changed;
+}
+
+void watch_stop(FileWatch *watch) {
+    if(watch->notify != NULL) {
+        uint64_t one = 1;
+        write(watch->stopFd, &one, sizeof(one));
+        pthread_join(watch->thread, NULL);
+        watch->notify = NULL;
+    }
+
+    if(watch->stopFd != -1) close(watch->stopFd);
+    watch->stopFd = -1;
+
+    close(watch->fd);
+    free(watch->fileName);
+    watch->fd = -1;
+    watch->fileName = NULL;
+}
@@ -0,0 +1,25 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <pthread.h>
+#include <stdbool.h>
+
+typedef struct {
+    int fd; // inotify instance
+    int wd; // watch of the directory of the file
+    char *fileName;
+
+    // waits for the events of fd to call notify
+    void (*notify)(void);
+    pthread_t thread;
+    int stopFd; // eventfd that stops the thread
+} FileWatch;
+
+// notify can be NULL, it's called from another thread when there are new events, so a
+// loop that sleeps until something happens knows when to call watch_poll
+bool watch_start(FileWatch *watch, const char *filePath, void (*notify)(void));
+// doesn't block, returns true if the file was written since the last call
+bool watch_poll(FileWatch *watch);
+void watch_stop(FileWatch *watch);
+
+#endif // WATCH_H